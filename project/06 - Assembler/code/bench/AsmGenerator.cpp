@@ -0,0 +1,161 @@
+// 合成 .asm 生成器：为汇编器吞吐量基准生成任意规模的程序
+// cd "project/06 - Assembler/code/src"
+// make bench                                      # 自动生成 10k / 100k / 1M 行的语料
+// ./gen-asm --lines=10000000 --labels=0.05 --variables=0.1 --comments=0.2 > big.asm
+//
+// 指令分布模仿 VM 翻译器的输出：A / C 指令大约各占一半，C 指令取自常见的栈操作序列，
+// A 指令引用预定义符号、数字常量、标签（前向和后向）和变量。
+//   --lines=N          总行数（包括标签、注释和空行）
+//   --labels=P         标签声明所占行的比例
+//   --variables=P      A 指令中引用变量的比例
+//   --variable-count=N 不同变量的个数
+//   --comments=P       注释噪声：纯注释行、行尾注释和缩进的比例
+//   --seed=N           随机数种子，相同参数生成相同的文件
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+struct GeneratorOptions {
+    uint64_t lines = 100000;
+    double labels = 0.05;
+    double variables = 0.1;
+    uint32_t variableCount = 1000;
+    double comments = 0.2;
+    uint64_t seed = 1;
+};
+
+// xorshift64*：足够随机，且不同平台结果一致
+class Random {
+private:
+    uint64_t state;
+
+public:
+    explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // [0, bound)
+    uint64_t below(uint64_t bound) {
+        return next() % bound;
+    }
+
+    bool chance(double probability) {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+    }
+};
+
+static const char* const C_INSTRUCTIONS[] = {
+    "D=M", "A=M", "M=D", "D=A", "AM=M-1", "M=M+1", "D=D+M", "D=M-D", "M=D+M", "MD=M-1",
+    "A=A-1", "M=-1", "M=0", "M=!M", "D=D-A", "A=D+A", "D;JGT", "D;JEQ", "D;JNE", "0;JMP",
+};
+
+static const char* const PREDEFINED[] = {"SP", "LCL", "ARG", "THIS", "THAT", "R13", "R14", "R15"};
+
+static const char* const COMMENTS[] = {
+    "// push constant 7", "// pop local 0", "// call Math.multiply 2", "// label LOOP_START", "//",
+};
+
+static std::string labelName(uint64_t id) {
+    // 形如 VM 翻译器生成的函数内标签
+    return "Module" + std::to_string(id % 97) + ".function$LABEL_" + std::to_string(id);
+}
+
+static bool parseOption(const std::string& arg, GeneratorOptions& options) {
+    size_t equal = arg.find('=');
+    if (equal == std::string::npos) return false;
+    std::string name = arg.substr(0, equal);
+    std::string value = arg.substr(equal + 1);
+    try {
+        if (name == "--lines") options.lines = std::stoull(value);
+        else if (name == "--labels") options.labels = std::stod(value);
+        else if (name == "--variables") options.variables = std::stod(value);
+        else if (name == "--variable-count") options.variableCount = static_cast<uint32_t>(std::stoul(value));
+        else if (name == "--comments") options.comments = std::stod(value);
+        else if (name == "--seed") options.seed = std::stoull(value);
+        else return false;
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!parseOption(argv[i], options)) {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            std::cerr << "用法: gen-asm [--lines=N] [--labels=P] [--variables=P] [--variable-count=N] "
+                         "[--comments=P] [--seed=N]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.variableCount == 0) options.variableCount = 1;
+
+    Random random(options.seed);
+    // 预先确定标签总数，引用可以指向任意一个（前向或后向），没来得及定义的在末尾补上
+    uint64_t plannedLabels = static_cast<uint64_t>(static_cast<double>(options.lines) * options.labels) + 1;
+    uint64_t definedLabels = 0;
+
+    std::string out;
+    out.reserve(1 << 20);
+    auto flush = [&out]() {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+    };
+
+    // 末尾还要补上未定义的标签和 3 行停机循环，合计正好 --lines 行
+    uint64_t line = 0;
+    while (line + (plannedLabels - definedLabels) + 3 < options.lines) {
+        line++;
+        if (random.chance(options.labels) && definedLabels < plannedLabels) {
+            out += "(" + labelName(definedLabels++) + ")\n";
+            continue;
+        }
+        if (random.chance(options.comments * 0.5)) {
+            out += random.chance(0.2) ? "\n" : std::string(COMMENTS[random.below(5)]) + "\n";
+            continue;
+        }
+
+        if (random.chance(options.comments * 0.3)) {
+            out += "    ";
+        }
+        if (random.chance(0.5)) {
+            out += '@';
+            if (random.chance(options.variables)) {
+                out += "var" + std::to_string(random.below(options.variableCount));
+            } else {
+                switch (random.below(4)) {
+                    case 0: out += labelName(random.below(plannedLabels)); break;
+                    case 1: out += std::to_string(random.below(32768)); break;
+                    default: out += PREDEFINED[random.below(8)]; break;
+                }
+            }
+        } else {
+            out += C_INSTRUCTIONS[random.below(sizeof(C_INSTRUCTIONS) / sizeof(C_INSTRUCTIONS[0]))];
+        }
+        if (random.chance(options.comments * 0.2)) {
+            out += "   // trailing comment";
+        }
+        out += '\n';
+        if (out.size() >= (1 << 20)) {
+            flush();
+        }
+    }
+
+    while (definedLabels < plannedLabels) {
+        out += "(" + labelName(definedLabels++) + ")\n";
+        if (out.size() >= (1 << 20)) {
+            flush();
+        }
+    }
+    out += "(END)\n@END\n0;JMP\n";
+    flush();
+    return 0;
+}
@@ -0,0 +1,194 @@
+// 汇编器吞吐量基准：整体吞吐量、峰值内存，以及解析 / 编码 / 符号表三个阶段各自的耗时
+// cd "project/06 - Assembler/code/src"
+// make bench                                         # 生成合成语料并逐个测量
+// ./asm-bench ../bench/corpus/synth-1000000.asm      # 测量任意 .asm 文件
+// ./asm-bench --repeat=10 --min-rate=5000000 big.asm # 吞吐量低于下限时返回 1，用于防止性能回退
+//
+// 整体时间是默认单遍路径的完整流程：内存映射源文件、汇编（含语法检查）、格式化 .hack 并写入 /dev/null。
+// 三个阶段在同一份源码上分别单独计时，对应单遍汇编器里的三部分工作：
+//   Parser      LineScanner 逐行切分、去注释和空白、按首字符区分 A / C / 标签
+//   Code        encodeCInstruction：C 指令助记符查表编码（Code.h）
+//   SymbolTable 按源码顺序驻留标签和 A 指令符号、回填并分配变量
+// 每项取多次运行中的最小值；峰值内存是完成整体流程后进程的最大常驻内存。
+// 测量之前先汇编一遍：有语法错误时报错并返回 1；超出 32K ROM 不算失败（合成语料本来就很大）。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+#include "AsmLexer.h"
+#include "HackAssembler.h"
+#include "MappedFile.h"
+#include "SymbolTable.h"
+
+// 符号事件：按源码顺序记录标签定义和 A 指令中的符号引用
+struct SymbolEvent {
+    std::string_view name;
+    bool isLabel;
+    size_t address; // 标签定义时的 ROM 地址；引用时为指令下标
+};
+
+struct Corpus {
+    size_t lines = 0;
+    std::vector<std::string_view> cInstructions;
+    std::vector<SymbolEvent> symbols;
+    size_t instructions = 0;
+};
+
+// 阶段计时的结果写到这里，编译器不能把计算当作无用代码删掉
+static volatile uint64_t checksumSink;
+
+template <typename Fn>
+static double fastest(int repeat, Fn fn) {
+    double best = 1e300;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 解析阶段：与单遍汇编器相同的逐行扫描，顺便收集后两个阶段的输入
+static void parse(std::string_view source, Corpus& corpus) {
+    corpus.cInstructions.clear();
+    corpus.symbols.clear();
+    corpus.instructions = 0;
+    LineScanner scanner(source);
+    std::string_view line;
+    while (scanner.next(line)) {
+        if (line[0] == '(') {
+            corpus.symbols.push_back({line.substr(1, line.size() - 2), true, corpus.instructions});
+        } else if (line[0] == '@') {
+            std::string_view symbol = line.substr(1);
+            if (!isNumber(symbol)) {
+                corpus.symbols.push_back({symbol, false, corpus.instructions});
+            }
+            corpus.instructions++;
+        } else {
+            corpus.cInstructions.push_back(line);
+            corpus.instructions++;
+        }
+    }
+    corpus.lines = scanner.lineNumber();
+}
+
+int main(int argc, char* argv[]) {
+    int repeat = 5;
+    double minRate = 0;
+    std::string inputFile;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--repeat=", 0) == 0) {
+            repeat = std::max(1, std::stoi(arg.substr(9)));
+        } else if (arg.rfind("--min-rate=", 0) == 0) {
+            minRate = std::stod(arg.substr(11));
+        } else {
+            inputFile = arg;
+        }
+    }
+    if (inputFile.empty()) {
+        std::cerr << "用法: asm-bench [--repeat=N] [--min-rate=行每秒] 文件.asm" << std::endl;
+        return 1;
+    }
+
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return 1;
+    }
+
+    // 先检查语料：有语法错误时测出的吞吐量没有意义。合成语料为了测量吞吐量可以远超 32K ROM，
+    // 超出 ROM 是唯一允许的错误，照常测量并注明
+    bool overflowsRom = false;
+    {
+        Diagnostics diagnostics;
+        overflowsRom = assemble(source.view(), diagnostics).size() > ROM_SIZE;
+        if (diagnostics.errorCount() > (overflowsRom ? 1u : 0u)) {
+            diagnostics.print(std::cerr, inputFile);
+            std::cerr << "语料有语法错误，不做测量" << std::endl;
+            return 1;
+        }
+    }
+
+    long rssBefore = peakRssKb();
+    size_t words = 0;
+    double totalMs = fastest(repeat, [&]() {
+        MappedFile mapped(inputFile); // 内存映射也计入整体时间
+        Diagnostics diagnostics;
+        std::vector<uint16_t> rom = assemble(mapped.view(), diagnostics);
+        HackWriter::write("/dev/null", rom, OutputFormat::TEXT);
+        words = rom.size();
+    });
+    long rssPeak = peakRssKb();
+
+    Corpus corpus;
+    corpus.cInstructions.reserve(words);
+    corpus.symbols.reserve(words);
+    double parserMs = fastest(repeat, [&]() { parse(source.view(), corpus); });
+
+    double codeMs = fastest(repeat, [&]() {
+        const char* error = nullptr;
+        uint32_t checksum = 0;
+        for (std::string_view instruction : corpus.cInstructions) {
+            checksum += encodeCInstruction(instruction, &error);
+        }
+        checksumSink = checksum;
+    });
+
+    double symbolMs = fastest(repeat, [&]() {
+        SymbolTable symbolTable;
+        std::vector<uint32_t> references;
+        references.reserve(corpus.symbols.size());
+        for (const SymbolEvent& event : corpus.symbols) {
+            uint32_t id = symbolTable.intern(event.name);
+            if (event.isLabel) {
+                symbolTable.address(id) = static_cast<int>(event.address);
+            } else {
+                references.push_back(id);
+            }
+        }
+        int nextVariableAddress = VARIABLE_BASE;
+        uint64_t checksum = 0;
+        for (uint32_t id : references) {
+            int& address = symbolTable.address(id);
+            if (address == SymbolTable::UNRESOLVED) {
+                address = nextVariableAddress++;
+            }
+            checksum += static_cast<uint64_t>(address);
+        }
+        checksumSink = checksum;
+    });
+
+    double linesPerSecond = static_cast<double>(corpus.lines) / (totalMs / 1000.0);
+    double megabytesPerSecond = static_cast<double>(source.view().size()) / (1 << 20) / (totalMs / 1000.0);
+    auto share = [totalMs](double ms) { return static_cast<int>(ms * 100 / totalMs + 0.5); };
+
+    std::cout << inputFile << ": " << corpus.lines << " 行, " << words << " 条指令, "
+              << source.view().size() / 1024 << " KB" << (overflowsRom ? "（超出 32K ROM，只测量吞吐量）" : "")
+              << std::endl;
+    std::cout << "  整体:        " << totalMs << " ms, " << static_cast<long>(linesPerSecond) << " 行/秒, "
+              << megabytesPerSecond << " MB/s" << std::endl;
+    std::cout << "  峰值内存:    " << rssPeak / 1024 << " MB（开始前 " << rssBefore / 1024 << " MB）" << std::endl;
+    std::cout << "  Parser:      " << parserMs << " ms (" << share(parserMs) << "%)" << std::endl;
+    std::cout << "  Code:        " << codeMs << " ms (" << share(codeMs) << "%)" << std::endl;
+    std::cout << "  SymbolTable: " << symbolMs << " ms (" << share(symbolMs) << "%)" << std::endl;
+
+    if (minRate > 0 && linesPerSecond < minRate) {
+        std::cerr << "吞吐量 " << static_cast<long>(linesPerSecond) << " 行/秒低于下限 "
+                  << static_cast<long>(minRate) << std::endl;
+        return 1;
+    }
+    return 0;
+}
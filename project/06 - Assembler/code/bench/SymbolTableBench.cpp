@@ -0,0 +1,137 @@
+// 符号表微基准：对比旧的 unordered_map 符号表与驻留 + 开放寻址的 SymbolTable
+// cd "project/06 - Assembler/code/src"
+// make bench-symtab
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SymbolTable.h"
+
+// 旧实现：unordered_map<string,int>，构造时逐个插入预定义符号，
+// 汇编器先 contains() 再 getAddress()，同一个字符串哈希两次
+class LegacySymbolTable {
+private:
+    std::unordered_map<std::string, int> table;
+
+public:
+    LegacySymbolTable() {
+        for (const PredefinedSymbol& entry : PREDEFINED_SYMBOLS) {
+            table[entry.name] = entry.address;
+        }
+    }
+
+    void addEntry(const std::string& symbol, int address) {
+        table[symbol] = address;
+    }
+
+    bool contains(const std::string& symbol) const {
+        return table.find(symbol) != table.end();
+    }
+
+    int getAddress(const std::string& symbol) const {
+        return table.at(symbol);
+    }
+};
+
+// 模拟 VM 翻译器生成的符号：RETURN_n、EQ_TRUE_n、Func$label 和预定义符号
+static std::vector<std::string> makeLabels(int count) {
+    std::vector<std::string> labels;
+    labels.reserve(count);
+    for (int i = 0; i < count; i++) {
+        switch (i % 3) {
+            case 0: labels.push_back("RETURN_" + std::to_string(i)); break;
+            case 1: labels.push_back("EQ_TRUE" + std::to_string(i)); break;
+            default: labels.push_back("Screen.drawRectangle$WHILE_EXP" + std::to_string(i)); break;
+        }
+    }
+    return labels;
+}
+
+static std::vector<std::string> makeReferences(const std::vector<std::string>& labels, int count) {
+    static const char* predefined[] = {"SP", "LCL", "ARG", "THIS", "THAT", "R13", "R14", "R15"};
+    std::vector<std::string> references;
+    references.reserve(count);
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t r = seed >> 8;
+        if (r % 4 == 0) {
+            references.push_back(labels[r % labels.size()]);
+        } else if (r % 4 == 1) {
+            references.push_back("Main." + std::to_string(r % 200)); // static 变量
+        } else {
+            references.push_back(predefined[r % 8]);
+        }
+    }
+    return references;
+}
+
+template <typename Fn>
+static double measure(Fn fn, int repeat) {
+    auto start = std::chrono::steady_clock::now();
+    long checksum = 0;
+    for (int i = 0; i < repeat; i++) {
+        checksum += fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (checksum == 42) std::cout << "";  // 防止整体被优化掉
+    return std::chrono::duration<double, std::milli>(end - start).count() / repeat;
+}
+
+int main(int argc, char* argv[]) {
+    int labelCount = (argc > 1) ? std::stoi(argv[1]) : 20000;
+    int referenceCount = (argc > 2) ? std::stoi(argv[2]) : 500000;
+    const int repeat = 10;
+
+    std::vector<std::string> labels = makeLabels(labelCount);
+    std::vector<std::string> references = makeReferences(labels, referenceCount);
+
+    double legacyMs = measure([&]() {
+        LegacySymbolTable table;
+        for (size_t i = 0; i < labels.size(); i++) {
+            table.addEntry(labels[i], static_cast<int>(i));
+        }
+        long sum = 0;
+        int nextVariableAddress = 16;
+        for (const std::string& symbol : references) {
+            if (table.contains(symbol)) {
+                sum += table.getAddress(symbol);
+            } else {
+                table.addEntry(symbol, nextVariableAddress);
+                sum += nextVariableAddress++;
+            }
+        }
+        return sum;
+    }, repeat);
+
+    double internedMs = measure([&]() {
+        SymbolTable table;
+        for (size_t i = 0; i < labels.size(); i++) {
+            table.addEntry(labels[i], static_cast<int>(i));
+        }
+        long sum = 0;
+        int nextVariableAddress = 16;
+        for (const std::string& symbol : references) {
+            int& address = table.lookupOrInsert(symbol);
+            if (address == SymbolTable::UNRESOLVED) {
+                address = nextVariableAddress++;
+            }
+            sum += address;
+        }
+        return sum;
+    }, repeat);
+
+    double legacyCtorMs = measure([]() { LegacySymbolTable table; return 1L; }, 10000);
+    double internedCtorMs = measure([]() { SymbolTable table; return 1L; }, 10000);
+
+    std::cout << "标签数: " << labelCount << ", 引用数: " << referenceCount << std::endl;
+    std::cout << "unordered_map 符号表: " << legacyMs << " ms/轮, 构造 "
+              << legacyCtorMs * 1000 << " us" << std::endl;
+    std::cout << "驻留开放寻址符号表:   " << internedMs << " ms/轮, 构造 "
+              << internedCtorMs * 1000 << " us" << std::endl;
+    std::cout << "加速比: " << legacyMs / internedMs << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#ifndef ASMLEXER_H
+#define ASMLEXER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "Code.h"
+
+// Hack 汇编的词法工具，全部基于指向源码的 string_view，不做堆分配
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline std::string_view trim(std::string_view str) {
+    size_t first = 0;
+    while (first < str.size() && isSpace(str[first])) first++;
+    size_t last = str.size();
+    while (last > first && isSpace(str[last - 1])) last--;
+    return str.substr(first, last - first);
+}
+
+inline std::string_view removeComments(std::string_view line) {
+    size_t pos = line.find("//");
+    if (pos != std::string_view::npos) {
+        return line.substr(0, pos);
+    }
+    return line;
+}
+
+inline bool isNumber(std::string_view str) {
+    if (str.empty()) return false;
+    for (char c : str) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
+inline uint16_t parseNumber(std::string_view str) {
+    unsigned value = 0;
+    for (char c : str) {
+        value = value * 10 + static_cast<unsigned>(c - '0');
+    }
+    return static_cast<uint16_t>(value);
+}
+
+// dest=comp;jump -> 16 位机器码
+// 助记符无效时该字段按 0 编码；若传入 error，则写入对应的错误描述
+inline uint16_t encodeCInstruction(std::string_view command, const char** error = nullptr) {
+    size_t equalPos = command.find('=');
+    size_t semiPos = command.find(';');
+
+    std::string_view destStr = (equalPos != std::string_view::npos)
+                             ? command.substr(0, equalPos)
+                             : std::string_view();
+    size_t start = (equalPos != std::string_view::npos) ? equalPos + 1 : 0;
+    size_t end = (semiPos != std::string_view::npos) ? semiPos : command.size();
+    std::string_view compStr = command.substr(start, end - start);
+    std::string_view jumpStr = (semiPos != std::string_view::npos)
+                             ? command.substr(semiPos + 1)
+                             : std::string_view();
+
+    if (error != nullptr) {
+        if (!Code::isValidComp(compStr)) {
+            *error = "无效的 comp 助记符";
+        } else if (!Code::isValidDest(destStr)) {
+            *error = "无效的 dest 助记符";
+        } else if (!Code::isValidJump(jumpStr)) {
+            *error = "无效的 jump 助记符";
+        }
+    }
+
+    return Code::C_PREFIX | Code::comp(compStr) | Code::dest(destStr) | Code::jump(jumpStr);
+}
+
+// 标签声明 (Xxx) 的语法检查，合法时返回 nullptr
+inline const char* checkLabel(std::string_view line) {
+    if (line.size() < 3 || line.back() != ')') {
+        return "标签格式错误，应为 (LABEL)";
+    }
+    return nullptr;
+}
+
+// A 指令操作数的语法检查，合法时返回 nullptr
+inline const char* checkAOperand(std::string_view operand) {
+    if (operand.empty()) {
+        return "A 指令缺少操作数";
+    }
+    if (isNumber(operand)) {
+        unsigned value = 0;
+        for (char c : operand) {
+            value = value * 10 + static_cast<unsigned>(c - '0');
+            if (value > 32767) return "常量超出 A 指令的 15 位范围 (0..32767)";
+        }
+    } else if (operand[0] >= '0' && operand[0] <= '9') {
+        return "符号不能以数字开头";
+    }
+    return nullptr;
+}
+
+// 逐行扫描源码，跳过空行和纯注释行，返回去掉注释和首尾空白的指令行
+class LineScanner {
+private:
+    const char* cursor;
+    const char* limit;
+    size_t line;
+
+public:
+    LineScanner(std::string_view source)
+        : cursor(source.data()), limit(source.data() + source.size()), line(0) {}
+
+    // 上一次 next() 返回的指令所在的行号（从 1 开始）
+    size_t lineNumber() const {
+        return line;
+    }
+
+    bool next(std::string_view& instruction) {
+        while (cursor < limit) {
+            line++;
+            const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', limit - cursor));
+            const char* lineEnd = (newline != nullptr) ? newline : limit;
+            instruction = trim(removeComments(std::string_view(cursor, lineEnd - cursor)));
+            cursor = (newline != nullptr) ? newline + 1 : limit;
+
+            if (!instruction.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif
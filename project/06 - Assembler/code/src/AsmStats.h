@@ -0,0 +1,179 @@
+#ifndef ASMSTATS_H
+#define ASMSTATS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Code.h"
+#include "Diagnostics.h"
+#include "SinglePass.h"
+
+// 汇编统计：指令构成、最常见的 comp/dest/jump 编码、标签和变量个数、ROM/RAM 占用，
+// 以及按标签划分的最大代码区域，用来找出代码膨胀来自哪个生成器、哪个函数。
+// 区域从一个标签地址开始，到下一个不同的标签地址为止，以该地址上第一个定义的标签命名。
+struct AsmStatistics {
+    struct Count {
+        std::string mnemonic;
+        size_t count;
+    };
+
+    struct Region {
+        std::string label;
+        size_t start;
+        size_t size;
+    };
+
+    size_t aInstructions = 0;
+    size_t cInstructions = 0;
+    size_t labels = 0;
+    size_t variables = 0; // 从 RAM[16] 开始分配
+    std::vector<Count> comps; // 以下均按次数 / 长度降序
+    std::vector<Count> dests;
+    std::vector<Count> jumps;
+    std::vector<Region> regions;
+
+    size_t romWords() const {
+        return aInstructions + cInstructions;
+    }
+
+    static AsmStatistics collect(std::string_view source, Diagnostics* diagnostics = nullptr) {
+        AsmStatistics stats;
+        SinglePassAssembler::SourceScan scan;
+        SinglePassAssembler().scan(source, scan, diagnostics);
+        const SymbolTable& symbolTable = scan.symbolTable;
+
+        size_t compCounts[128] = {};
+        size_t destCounts[8] = {};
+        size_t jumpCounts[8] = {};
+        for (uint16_t word : scan.words) {
+            if ((word & 0x8000) == 0) {
+                stats.aInstructions++;
+                continue;
+            }
+            stats.cInstructions++;
+            compCounts[(word >> 6) & 0x7F]++;
+            destCounts[(word >> 3) & 0x7]++;
+            jumpCounts[word & 0x7]++;
+        }
+        for (int bits = 0; bits < 128; bits++) {
+            if (compCounts[bits] > 0) stats.comps.push_back({compName(bits), compCounts[bits]});
+        }
+        static const char* const DEST[] = {"null", "M", "D", "MD", "A", "AM", "AD", "AMD"};
+        static const char* const JUMP[] = {"null", "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP"};
+        for (int bits = 0; bits < 8; bits++) {
+            if (destCounts[bits] > 0) stats.dests.push_back({DEST[bits], destCounts[bits]});
+            if (jumpCounts[bits] > 0) stats.jumps.push_back({JUMP[bits], jumpCounts[bits]});
+        }
+        sortByCount(stats.comps);
+        sortByCount(stats.dests);
+        sortByCount(stats.jumps);
+
+        // 标签按地址排序；同一地址按 id（首次出现的顺序），取第一个命名区域
+        std::vector<std::pair<size_t, uint32_t>> labelAddresses;
+        for (uint32_t id = 0; id < symbolTable.size(); id++) {
+            if (scan.definesLabel(id)) {
+                labelAddresses.push_back({static_cast<size_t>(symbolTable.address(id)), id});
+            }
+        }
+        stats.labels = labelAddresses.size();
+        std::sort(labelAddresses.begin(), labelAddresses.end());
+
+        size_t total = scan.words.size();
+        size_t start = 0;
+        std::string name = "(程序开头)";
+        bool named = false; // 当前区域是否已经以标签命名
+        for (const auto& [address, id] : labelAddresses) {
+            if (address != start) {
+                stats.regions.push_back({name, start, address - start});
+                start = address;
+                named = false;
+            }
+            if (!named) {
+                name = std::string(symbolTable.name(id));
+                named = true;
+            }
+        }
+        if (total > start) {
+            stats.regions.push_back({name, start, total - start});
+        }
+        std::stable_sort(stats.regions.begin(), stats.regions.end(),
+                         [](const Region& a, const Region& b) { return a.size > b.size; });
+
+        // 变量：被引用、但既不是预定义符号也不是标签的符号
+        std::vector<bool> counted(symbolTable.size(), false);
+        for (const SinglePassAssembler::Fixup& fixup : scan.fixups) {
+            if (!counted[fixup.symbol] && symbolTable.address(fixup.symbol) == SymbolTable::UNRESOLVED) {
+                counted[fixup.symbol] = true;
+                stats.variables++;
+            }
+        }
+        return stats;
+    }
+
+    void print(std::ostream& out, size_t top = 10) const {
+        size_t words = romWords();
+        auto percent = [](size_t part, size_t whole) {
+            return whole == 0 ? 0.0 : part * 100.0 / whole;
+        };
+        out << std::fixed << std::setprecision(1);
+        out << "指令: " << words << " 条（A 指令 " << aInstructions << "，" << percent(aInstructions, words)
+            << "%；C 指令 " << cInstructions << "，" << percent(cInstructions, words) << "%）" << std::endl;
+        out << "ROM: " << words << " / " << ROM_SIZE << "（" << percent(words, ROM_SIZE) << "%）"
+            << (words > ROM_SIZE ? "，超出 " + std::to_string(words - ROM_SIZE) + " 条" : "") << std::endl;
+        size_t ramSize = static_cast<size_t>(VARIABLE_LIMIT - VARIABLE_BASE);
+        out << "变量: " << variables << " 个，RAM[" << VARIABLE_BASE << "] 起（可用 " << ramSize << " 个中的 "
+            << percent(variables, ramSize) << "%）" << std::endl;
+        out << "标签: " << labels << " 个，平均每 " << (labels == 0 ? 0.0 : static_cast<double>(words) / labels)
+            << " 条指令一个" << std::endl;
+
+        printCounts(out, "comp", comps, cInstructions, top);
+        printCounts(out, "dest", dests, cInstructions, top);
+        printCounts(out, "jump", jumps, cInstructions, top);
+
+        out << "最大的标签区域:" << std::endl;
+        for (size_t i = 0; i < regions.size() && i < top; i++) {
+            out << "  " << std::setw(7) << regions[i].size << "  " << std::setw(5) << percent(regions[i].size, words)
+                << "%  @" << regions[i].start << "  " << regions[i].label << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+private:
+    // comp 位段（含 a 位）-> 助记符，无效编码输出二进制
+    static std::string compName(int bits) {
+        static const char* const MNEMONICS[] = {
+            "0", "1", "-1", "D", "A", "!D", "!A", "-D", "-A", "D+1", "A+1", "D-1", "A-1", "D+A", "D-A",
+            "A-D", "D&A", "D|A", "M", "!M", "-M", "M+1", "M-1", "D+M", "D-M", "M-D", "D&M", "D|M",
+        };
+        for (const char* mnemonic : MNEMONICS) {
+            if ((Code::comp(mnemonic) >> 6) == bits) {
+                return mnemonic;
+            }
+        }
+        std::string binary;
+        for (int bit = 6; bit >= 0; bit--) binary += ((bits >> bit) & 1) ? '1' : '0';
+        return binary;
+    }
+
+    static void sortByCount(std::vector<Count>& counts) {
+        std::stable_sort(counts.begin(), counts.end(),
+                         [](const Count& a, const Count& b) { return a.count > b.count; });
+    }
+
+    static void printCounts(std::ostream& out, const char* field, const std::vector<Count>& counts,
+                            size_t total, size_t top) {
+        out << "最常见的 " << field << ":";
+        for (size_t i = 0; i < counts.size() && i < top; i++) {
+            out << "  " << counts[i].mnemonic << " " << counts[i].count << " ("
+                << (total == 0 ? 0.0 : counts[i].count * 100.0 / total) << "%)";
+        }
+        out << std::endl;
+    }
+};
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+// 汇编器版本：改动会影响输出的机器码时必须修改，旧的缓存项随之失效
+inline constexpr const char* ASSEMBLER_VERSION = "hack-assembler 2";
+
+// 64 位内容哈希：每次处理 8 字节，比逐字节的 FNV-1a 快得多，用作缓存键
+inline uint64_t hashContent(std::string_view data, uint64_t seed = 0) {
+    const uint64_t k1 = 0x9E3779B185EBCA87ull;
+    const uint64_t k2 = 0xC2B2AE3D27D4EB4Full;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto mix = [&](uint64_t h, uint64_t v) {
+        v *= k2;
+        v = rotl(v, 31);
+        v *= k1;
+        h ^= v;
+        return rotl(h, 27) * 5 + 0x52DCE729;
+    };
+
+    uint64_t h = seed ^ (data.size() * k1);
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t v;
+        std::memcpy(&v, data.data() + i, 8);
+        h = mix(h, v);
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < data.size(); i++, shift += 8) {
+        tail |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << shift;
+    }
+    h = mix(h, tail);
+
+    // 最后再充分混合一次（murmur3 fmix64）
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// 以内容寻址的构建缓存：键是源码、汇编器版本和输出变体（格式、是否压缩）的哈希，
+// 值是汇编好的输出文件。命中时不做任何解析，直接把缓存文件 reflink（文件系统支持时）
+// 或复制到输出位置。每次命中都会更新缓存项的修改时间，超出容量上限时按最久未用淘汰。
+// 命中/未命中等计数在进程结束时累加到缓存目录下的 stats 文件（用 flock 互斥）。
+class BuildCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+    };
+
+private:
+    std::string directory;
+    uint64_t maxBytes;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> stores{0};
+    std::atomic<uint64_t> temporaries{0}; // 临时文件序号，批量模式下多个线程同时写入
+    uint64_t evictions = 0;
+
+    std::string entryPath(uint64_t key, const std::string& extension) const {
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return directory + "/" + name + extension;
+    }
+
+    // 先尝试 reflink（共享数据块，不复制内容），不支持时退回普通复制
+    static bool copyFile(const std::string& from, const std::string& to) {
+        int in = ::open(from.c_str(), O_RDONLY);
+        if (in < 0) {
+            return false;
+        }
+        int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) {
+            close(in);
+            return false;
+        }
+
+        bool ok = false;
+#ifdef FICLONE
+        ok = ioctl(out, FICLONE, in) == 0;
+#endif
+        if (!ok) {
+            ok = true;
+            char buffer[64 * 1024];
+            ssize_t count;
+            while ((count = read(in, buffer, sizeof(buffer))) != 0) {
+                if (count < 0) {
+                    ok = false;
+                    break;
+                }
+                if (write(out, buffer, static_cast<size_t>(count)) != count) {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        close(in);
+        return (close(out) == 0) && ok;
+    }
+
+    static Stats parseStats(const std::string& text) {
+        Stats stats;
+        unsigned long long h = 0, m = 0, s = 0, e = 0;
+        if (std::sscanf(text.c_str(), "hits %llu misses %llu stores %llu evictions %llu", &h, &m, &s, &e) == 4) {
+            stats.hits = h;
+            stats.misses = m;
+            stats.stores = s;
+            stats.evictions = e;
+        }
+        return stats;
+    }
+
+    static std::string readAll(int fd) {
+        std::string text;
+        char buffer[256];
+        ssize_t count;
+        lseek(fd, 0, SEEK_SET);
+        while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+            text.append(buffer, static_cast<size_t>(count));
+        }
+        return text;
+    }
+
+    // 超出容量上限时按修改时间从旧到新删除缓存项
+    void evict() {
+        struct Entry {
+            std::string path;
+            time_t mtime;
+            uint64_t size;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            if (name.size() < 16 || name.find('.') != 16) {
+                continue; // 只管理形如 <16 位十六进制>.<扩展名> 的缓存项
+            }
+            std::string path = directory + "/" + name;
+            struct stat statbuf;
+            if (stat(path.c_str(), &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+                entries.push_back({path, statbuf.st_mtime, static_cast<uint64_t>(statbuf.st_size)});
+                total += static_cast<uint64_t>(statbuf.st_size);
+            }
+        }
+        closedir(dir);
+
+        if (total <= maxBytes) {
+            return;
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+        for (const Entry& victim : entries) {
+            if (total <= maxBytes) break;
+            if (unlink(victim.path.c_str()) == 0) {
+                total -= victim.size;
+                evictions++;
+            }
+        }
+    }
+
+public:
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 256ull * 1024 * 1024;
+
+    BuildCache(const std::string& directory, uint64_t maxBytes = DEFAULT_MAX_BYTES)
+        : directory(directory), maxBytes(maxBytes) {}
+
+    // 创建缓存目录（包括不存在的上级目录），失败时返回 false
+    bool create() {
+        for (size_t slash = directory.find('/', 1); ; slash = directory.find('/', slash + 1)) {
+            std::string prefix = directory.substr(0, slash);
+            if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+            if (slash == std::string::npos) break;
+        }
+        struct stat statbuf;
+        return stat(directory.c_str(), &statbuf) == 0 && S_ISDIR(statbuf.st_mode);
+    }
+
+    const std::string& path() const {
+        return directory;
+    }
+
+    // variant 区分同一源码的不同输出（扩展名、是否压缩等）
+    static uint64_t key(std::string_view source, const std::string& variant) {
+        std::string salt = std::string(ASSEMBLER_VERSION) + "|" + variant;
+        return hashContent(source, hashContent(salt));
+    }
+
+    // 命中时把缓存项复制到 outputFile
+    bool fetch(uint64_t key, const std::string& extension, const std::string& outputFile) {
+        std::string entry = entryPath(key, extension);
+        if (access(entry.c_str(), R_OK) == 0 && copyFile(entry, outputFile)) {
+            utimensat(AT_FDCWD, entry.c_str(), nullptr, 0); // 记录最近使用时间
+            hits++;
+            return true;
+        }
+        misses++;
+        return false;
+    }
+
+    // 把刚生成的输出存入缓存：先写临时文件再 rename，并发进程不会读到半个文件
+    void store(uint64_t key, const std::string& extension, const std::string& outputFile) {
+        std::string entry = entryPath(key, extension);
+        std::string temporary = entry + ".tmp" + std::to_string(getpid()) + "." +
+                                std::to_string(temporaries++);
+        if (copyFile(outputFile, temporary) && rename(temporary.c_str(), entry.c_str()) == 0) {
+            stores++;
+        } else {
+            unlink(temporary.c_str());
+        }
+    }
+
+    // 本进程的计数
+    Stats sessionStats() const {
+        Stats stats;
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.stores = stores;
+        stats.evictions = evictions;
+        return stats;
+    }
+
+    // 进程结束前调用：必要时淘汰旧缓存项，并把本进程的计数累加到 stats 文件
+    void finish() {
+        if (stores > 0) {
+            evict();
+        }
+        Stats session = sessionStats();
+        if (session.hits + session.misses + session.stores + session.evictions == 0) {
+            return;
+        }
+
+        int fd = ::open((directory + "/stats").c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return;
+        }
+        flock(fd, LOCK_EX);
+        Stats total = parseStats(readAll(fd));
+        total.hits += session.hits;
+        total.misses += session.misses;
+        total.stores += session.stores;
+        total.evictions += session.evictions;
+        std::string text = "hits " + std::to_string(total.hits) + " misses " + std::to_string(total.misses) +
+                           " stores " + std::to_string(total.stores) +
+                           " evictions " + std::to_string(total.evictions) + "\n";
+        if (ftruncate(fd, 0) == 0) {
+            lseek(fd, 0, SEEK_SET);
+            ssize_t written = write(fd, text.data(), text.size());
+            (void)written;
+        }
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+
+    // 缓存目录的累计计数
+    Stats totalStats() const {
+        Stats stats;
+        int fd = ::open((directory + "/stats").c_str(), O_RDONLY);
+        if (fd >= 0) {
+            flock(fd, LOCK_SH);
+            stats = parseStats(readAll(fd));
+            flock(fd, LOCK_UN);
+            close(fd);
+        }
+        return stats;
+    }
+
+    // 当前缓存项个数和总字节数
+    void usage(size_t& entries, uint64_t& bytes) const {
+        entries = 0;
+        bytes = 0;
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            if (name.size() < 16 || name.find('.') != 16) continue;
+            struct stat statbuf;
+            if (stat((directory + "/" + name).c_str(), &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+                entries++;
+                bytes += static_cast<uint64_t>(statbuf.st_size);
+            }
+        }
+        closedir(dir);
+    }
+};
+
+#endif
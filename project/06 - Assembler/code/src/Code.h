@@ -1,90 +1,128 @@
 #ifndef CODE_H
 #define CODE_H
 
-#include <string>
-#include <unordered_map>
+#include <cstdint>
+#include <string_view>
 
+// C 指令格式：111a cccc ccdd djjj
+// 各编码函数直接返回已移到对应位置的位段，整条指令用按位或拼出：
+//     0xE000 | Code::comp(c) | Code::dest(d) | Code::jump(j)
+// 助记符不超过 3 个字符，打包成整数后用 switch 分派，全部可在编译期求值。
 class Code {
 private:
-    std::unordered_map<std::string, std::string> destMap;
-    std::unordered_map<std::string, std::string> compMap;
-    std::unordered_map<std::string, std::string> jumpMap;
+    // 把至多 3 个字符的助记符和长度打包成 switch 的键，过长的助记符映射到无效键
+    static constexpr uint32_t key(std::string_view mnemonic) {
+        if (mnemonic.size() > 3) {
+            return 0xFFFFFFFFu;
+        }
+        uint32_t k = static_cast<uint32_t>(mnemonic.size()) << 24;
+        for (size_t i = 0; i < mnemonic.size(); i++) {
+            k |= static_cast<uint32_t>(static_cast<unsigned char>(mnemonic[i])) << (8 * i);
+        }
+        return k;
+    }
+
+    // 以下三个查表函数对无效助记符返回 -1
+    static constexpr int32_t lookupDest(std::string_view mnemonic) {
+        switch (key(mnemonic)) {
+            case key("M"):   return 0x1 << 3;
+            case key("D"):   return 0x2 << 3;
+            case key("MD"):  return 0x3 << 3;
+            case key("A"):   return 0x4 << 3;
+            case key("AM"):  return 0x5 << 3;
+            case key("AD"):  return 0x6 << 3;
+            case key("AMD"): return 0x7 << 3;
+            case key(""):    return 0;
+            default:         return -1;
+        }
+    }
+
+    static constexpr int32_t lookupComp(std::string_view mnemonic) {
+        switch (key(mnemonic)) {
+            // a=0
+            case key("0"):   return 0x2A << 6;  // 0101010
+            case key("1"):   return 0x3F << 6;  // 0111111
+            case key("-1"):  return 0x3A << 6;  // 0111010
+            case key("D"):   return 0x0C << 6;  // 0001100
+            case key("A"):   return 0x30 << 6;  // 0110000
+            case key("!D"):  return 0x0D << 6;  // 0001101
+            case key("!A"):  return 0x31 << 6;  // 0110001
+            case key("-D"):  return 0x0F << 6;  // 0001111
+            case key("-A"):  return 0x33 << 6;  // 0110011
+            case key("D+1"): return 0x1F << 6;  // 0011111
+            case key("A+1"): return 0x37 << 6;  // 0110111
+            case key("D-1"): return 0x0E << 6;  // 0001110
+            case key("A-1"): return 0x32 << 6;  // 0110010
+            case key("D+A"): return 0x02 << 6;  // 0000010
+            case key("D-A"): return 0x13 << 6;  // 0010011
+            case key("A-D"): return 0x07 << 6;  // 0000111
+            case key("D&A"): return 0x00 << 6;  // 0000000
+            case key("D|A"): return 0x15 << 6;  // 0010101
+            // a=1, 用 M 代替 A
+            case key("M"):   return 0x70 << 6;  // 1110000
+            case key("!M"):  return 0x71 << 6;  // 1110001
+            case key("-M"):  return 0x73 << 6;  // 1110011
+            case key("M+1"): return 0x77 << 6;  // 1110111
+            case key("M-1"): return 0x72 << 6;  // 1110010
+            case key("D+M"): return 0x42 << 6;  // 1000010
+            case key("D-M"): return 0x53 << 6;  // 1010011
+            case key("M-D"): return 0x47 << 6;  // 1000111
+            case key("D&M"): return 0x40 << 6;  // 1000000
+            case key("D|M"): return 0x55 << 6;  // 1010101
+            default:         return -1;
+        }
+    }
+
+    static constexpr int32_t lookupJump(std::string_view mnemonic) {
+        switch (key(mnemonic)) {
+            case key("JGT"): return 0x1;
+            case key("JEQ"): return 0x2;
+            case key("JGE"): return 0x3;
+            case key("JLT"): return 0x4;
+            case key("JNE"): return 0x5;
+            case key("JLE"): return 0x6;
+            case key("JMP"): return 0x7;
+            case key(""):    return 0;
+            default:         return -1;
+        }
+    }
+
+    static constexpr uint16_t orZero(int32_t bits) {
+        return (bits < 0) ? 0 : static_cast<uint16_t>(bits);
+    }
 
 public:
-    Code() {
-        // dest 助记符
-        destMap[""] = "000";
-        destMap["M"] = "001";
-        destMap["D"] = "010";
-        destMap["MD"] = "011";
-        destMap["A"] = "100";
-        destMap["AM"] = "101";
-        destMap["AD"] = "110";
-        destMap["AMD"] = "111";
+    static constexpr uint16_t C_PREFIX = 0xE000;
 
-        // comp 助记符 (a=0)
-        compMap["0"] = "0101010";
-        compMap["1"] = "0111111";
-        compMap["-1"] = "0111010";
-        compMap["D"] = "0001100";
-        compMap["A"] = "0110000";
-        compMap["!D"] = "0001101";
-        compMap["!A"] = "0110001";
-        compMap["-D"] = "0001111";
-        compMap["-A"] = "0110011";
-        compMap["D+1"] = "0011111";
-        compMap["A+1"] = "0110111";
-        compMap["D-1"] = "0001110";
-        compMap["A-1"] = "0110010";
-        compMap["D+A"] = "0000010";
-        compMap["D-A"] = "0010011";
-        compMap["A-D"] = "0000111";
-        compMap["D&A"] = "0000000";
-        compMap["D|A"] = "0010101";
+    // 无效助记符按全 0 编码（与最初的实现一致），需要报错时先用 isValid* 检查
+    static constexpr uint16_t dest(std::string_view mnemonic) {
+        return orZero(lookupDest(mnemonic));
+    }
 
-        // comp 助记符 (a=1, 用 M 代替 A)
-        compMap["M"] = "1110000";
-        compMap["!M"] = "1110001";
-        compMap["-M"] = "1110011";
-        compMap["M+1"] = "1110111";
-        compMap["M-1"] = "1110010";
-        compMap["D+M"] = "1000010";
-        compMap["D-M"] = "1010011";
-        compMap["M-D"] = "1000111";
-        compMap["D&M"] = "1000000";
-        compMap["D|M"] = "1010101";
+    static constexpr uint16_t comp(std::string_view mnemonic) {
+        return orZero(lookupComp(mnemonic));
+    }
 
-        // jump 助记符
-        jumpMap[""] = "000";
-        jumpMap["JGT"] = "001";
-        jumpMap["JEQ"] = "010";
-        jumpMap["JGE"] = "011";
-        jumpMap["JLT"] = "100";
-        jumpMap["JNE"] = "101";
-        jumpMap["JLE"] = "110";
-        jumpMap["JMP"] = "111";
+    static constexpr uint16_t jump(std::string_view mnemonic) {
+        return orZero(lookupJump(mnemonic));
     }
 
-    std::string dest(const std::string& mnemonic) const {
-        if (destMap.find(mnemonic) != destMap.end()) {
-            return destMap.at(mnemonic);
-        }
-        return "000";
+    static constexpr bool isValidDest(std::string_view mnemonic) {
+        return lookupDest(mnemonic) >= 0;
     }
 
-    std::string comp(const std::string& mnemonic) const {
-        if (compMap.find(mnemonic) != compMap.end()) {
-            return compMap.at(mnemonic);
-        }
-        return "0000000";
+    static constexpr bool isValidComp(std::string_view mnemonic) {
+        return lookupComp(mnemonic) >= 0;
     }
 
-    std::string jump(const std::string& mnemonic) const {
-        if (jumpMap.find(mnemonic) != jumpMap.end()) {
-            return jumpMap.at(mnemonic);
-        }
-        return "000";
+    static constexpr bool isValidJump(std::string_view mnemonic) {
+        return lookupJump(mnemonic) >= 0;
     }
 };
 
+static_assert((Code::C_PREFIX | Code::comp("D+A") | Code::dest("D")) == 0xE090, "D=D+A");
+static_assert((Code::C_PREFIX | Code::comp("M") | Code::dest("AM")) == 0xFC28, "AM=M");
+static_assert((Code::C_PREFIX | Code::comp("0") | Code::jump("JMP")) == 0xEA87, "0;JMP");
+static_assert(!Code::isValidComp("D+D") && Code::isValidDest("") && !Code::isValidJump("JXX"), "validity");
+
 #endif
@@ -0,0 +1,334 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Code.h"
+#include "SinglePass.h"
+
+// 压缩结果：节省的 ROM 和增加的运行开销
+struct CompressionReport {
+    static constexpr int CYCLES_PER_CALL = 9; // 调用 6 条 + 返回 3 条
+
+    bool applied = false;
+    std::string reason;     // 没有压缩时的原因
+    size_t originalSize = 0;
+    size_t compressedSize = 0;
+    size_t subroutines = 0; // 抽取出的子程序个数
+    size_t callSites = 0;   // 被替换成调用的位置个数
+    int returnRegister = 0; // 存放返回地址的 RAM 单元
+};
+
+// 链接期代码压缩（过程抽象）：在汇编结果上用哈希查找重复出现的指令序列，
+// 每种序列只保留一份，放到程序末尾作为子程序，原来的位置改成调用：
+//     调用 (6 条)  @返回地址  D=A  @RET  M=D  @子程序  0;JMP
+//     返回 (3 条)  @RET  A=M  0;JMP
+// RET 是在所有变量之后新分配的 RAM 单元。调用会改写 D 和 A，所以只抽取这样的序列：
+// 序列内 D、A 都先写后读，不含跳转，中间没有标签；序列之后的代码在使用 A 之前会先改写 A，
+// 序列本身不写 D 时，之后的代码也不能再用到 D 的旧值。
+// 原程序靠执行到末尾结束时，在子程序之前补一个停机循环，免得继续执行到子程序里。
+// 最后按重定位信息把所有标签引用改成新地址。
+// 程序中出现"数字常量 + 跳转"（按绝对 ROM 地址跳转，如 Pong.asm）时无法重定位，拒绝压缩。
+class CodeCompressor {
+private:
+    static constexpr size_t MIN_LENGTH = 7; // 更短的序列抽取后不会变小
+    static constexpr size_t MAX_LENGTH = 48;
+    static constexpr size_t CALL_SIZE = 6;
+    static constexpr size_t RETURN_SIZE = 3;
+    static constexpr size_t HALT_SIZE = 2;
+    static constexpr int MAX_ROUNDS = 4;
+
+    struct Pattern {
+        size_t length;
+        std::vector<uint32_t> sites; // 各处出现的起始位置，互不重叠
+    };
+
+    const std::vector<uint16_t>& words;
+    const Relocations& relocations;
+    std::vector<bool> covered; // 已被某个选中序列占用的位置
+
+    // 标签引用即使地址超过 15 位也仍是 A 指令
+    bool isA(size_t i) const {
+        return relocations.labelReference[i] || (words[i] & 0x8000) == 0;
+    }
+
+    // C 指令：111a c1..c6 d1d2d3 j1j2j3，c1 (zx) 为 0 时读 D，c3 (zy) 为 0 时读 A 或 M；
+    // 写 M 和跳转都要用到 A
+    static bool readsD(uint16_t w) { return (w & 0x0800) == 0; }
+    static bool readsA(uint16_t w) { return (w & 0x0200) == 0 || (w & 0x0008) != 0 || (w & 0x0007) != 0; }
+    static bool writesD(uint16_t w) { return (w & 0x0010) != 0; }
+    static bool writesA(uint16_t w) { return (w & 0x0020) != 0; }
+    static bool jumps(uint16_t w) { return (w & 0x0007) != 0; }
+
+    uint64_t token(size_t i) const {
+        return (static_cast<uint64_t>(words[i]) << 1 | (relocations.labelReference[i] ? 1 : 0)) + 1;
+    }
+
+    bool sameSequence(size_t a, size_t b, size_t length) const {
+        for (size_t k = 0; k < length; k++) {
+            if (words[a + k] != words[b + k] ||
+                relocations.labelReference[a + k] != relocations.labelReference[b + k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 从 i 开始最长可以抽取多长：D、A 先写后读，无跳转，中间无标签；
+    // firstDWrite[i] 记录其中第一次写 D 的偏移（没有则等于最大长度）
+    std::vector<uint8_t> maxLengths(std::vector<uint8_t>& firstDWrite) const {
+        size_t n = words.size();
+        std::vector<uint8_t> result(n, 0);
+        firstDWrite.assign(n, 0);
+        for (size_t i = 0; i < n; i++) {
+            bool dWritten = false;
+            bool aWritten = false;
+            size_t length = 0;
+            size_t dWrite = MAX_LENGTH;
+            while (i + length < n && length < MAX_LENGTH) {
+                size_t k = i + length;
+                if (length > 0 && relocations.labelTarget[k]) break;
+                if (isA(k)) {
+                    aWritten = true;
+                } else {
+                    uint16_t w = words[k];
+                    if (jumps(w) || (readsD(w) && !dWritten) || (readsA(w) && !aWritten)) break;
+                    if (writesD(w) && !dWritten) dWrite = length;
+                    dWritten |= writesD(w);
+                    aWritten |= writesA(w);
+                }
+                length++;
+            }
+            result[i] = static_cast<uint8_t>(length);
+            firstDWrite[i] = static_cast<uint8_t>(dWrite);
+        }
+        return result;
+    }
+
+    // aDead[j] / dDead[j]：从 j 开始执行，寄存器的旧值在被改写之前不会被用到。
+    // 跳转目标处的情况不做分析，保守地认为 D 在跳转处仍然有用
+    void deadRegisters(std::vector<bool>& aDead, std::vector<bool>& dDead) const {
+        size_t n = words.size();
+        aDead.assign(n + 1, true);
+        dDead.assign(n + 1, true);
+        for (size_t j = n; j-- > 0;) {
+            if (isA(j)) {
+                aDead[j] = true;
+                dDead[j] = dDead[j + 1];
+                continue;
+            }
+            uint16_t w = words[j];
+            aDead[j] = !readsA(w) && (writesA(w) || aDead[j + 1]);
+            dDead[j] = !jumps(w) && !readsD(w) && (writesD(w) || dDead[j + 1]);
+        }
+    }
+
+    // 最后一条指令不是无条件跳转，或者有标签指向程序末尾
+    bool fallsOffEnd() const {
+        size_t n = words.size();
+        return n == 0 || relocations.labelTarget[n] || isA(n - 1) || (words[n - 1] & 0x0007) != 0x0007;
+    }
+
+    static long benefit(size_t length, size_t count) {
+        return static_cast<long>(count * length) - static_cast<long>(count * CALL_SIZE + length + RETURN_SIZE);
+    }
+
+    // 一轮搜索：对每个长度求所有可抽取窗口的哈希，排序后相同哈希的窗口即候选，
+    // 再按收益从大到小选取互不冲突的序列
+    size_t searchRound(const std::vector<uint8_t>& maxLength, const std::vector<uint8_t>& firstDWrite,
+                       const std::vector<bool>& aDead, const std::vector<bool>& dDead,
+                       std::vector<Pattern>& patterns) {
+        size_t n = words.size();
+        const uint64_t base = 1000003;
+        std::vector<uint64_t> prefix(n + 1, 0);
+        std::vector<uint64_t> power(MAX_LENGTH + 1, 1);
+        for (size_t i = 0; i < n; i++) {
+            prefix[i + 1] = prefix[i] * base + token(i);
+        }
+        for (size_t k = 1; k <= MAX_LENGTH; k++) {
+            power[k] = power[k - 1] * base;
+        }
+        std::vector<uint32_t> coveredPrefix(n + 1, 0);
+        for (size_t i = 0; i < n; i++) {
+            coveredPrefix[i + 1] = coveredPrefix[i] + (covered[i] ? 1 : 0);
+        }
+
+        std::vector<Pattern> candidates;
+        std::vector<std::pair<uint64_t, uint32_t>> windows;
+        for (size_t length = MAX_LENGTH; length >= MIN_LENGTH; length--) {
+            windows.clear();
+            for (size_t i = 0; i + length <= n; i++) {
+                if (maxLength[i] >= length && aDead[i + length] &&
+                    (firstDWrite[i] < length || dDead[i + length]) &&
+                    coveredPrefix[i + length] == coveredPrefix[i]) {
+                    windows.push_back({prefix[i + length] - prefix[i] * power[length], static_cast<uint32_t>(i)});
+                }
+            }
+            std::sort(windows.begin(), windows.end());
+
+            for (size_t first = 0; first < windows.size();) {
+                size_t last = first;
+                while (last < windows.size() && windows[last].first == windows[first].first) last++;
+                if (last - first >= 2) {
+                    Pattern pattern{length, {}};
+                    size_t nextFree = 0;
+                    for (size_t k = first; k < last; k++) {
+                        uint32_t site = windows[k].second;
+                        if (site >= nextFree && sameSequence(windows[first].second, site, length)) {
+                            pattern.sites.push_back(site);
+                            nextFree = site + length;
+                        }
+                    }
+                    if (benefit(length, pattern.sites.size()) > 0) {
+                        candidates.push_back(std::move(pattern));
+                    }
+                }
+                first = last;
+            }
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Pattern& a, const Pattern& b) {
+            return benefit(a.length, a.sites.size()) > benefit(b.length, b.sites.size());
+        });
+
+        size_t accepted = 0;
+        for (Pattern& candidate : candidates) {
+            std::vector<uint32_t> sites;
+            for (uint32_t site : candidate.sites) {
+                bool free = true;
+                for (size_t k = site; k < site + candidate.length && free; k++) {
+                    free = !covered[k];
+                }
+                if (free) sites.push_back(site);
+            }
+            if (benefit(candidate.length, sites.size()) <= 0) continue;
+            for (uint32_t site : sites) {
+                std::fill(covered.begin() + site, covered.begin() + site + candidate.length, true);
+            }
+            candidate.sites.swap(sites);
+            patterns.push_back(std::move(candidate));
+            accepted++;
+        }
+        return accepted;
+    }
+
+    // 按选中的序列重新排布程序并重定位标签引用
+    std::vector<uint16_t> rewrite(const std::vector<Pattern>& patterns, int returnRegister) const {
+        size_t n = words.size();
+        std::vector<int32_t> patternAt(n, -1);
+        for (size_t p = 0; p < patterns.size(); p++) {
+            for (uint32_t site : patterns[p].sites) {
+                patternAt[site] = static_cast<int32_t>(p);
+            }
+        }
+
+        // 旧地址 -> 新地址（被抽走的序列内部没有标签，不需要映射）
+        std::vector<uint32_t> newAddress(n + 1, 0);
+        size_t address = 0;
+        for (size_t i = 0; i < n;) {
+            newAddress[i] = static_cast<uint32_t>(address);
+            if (patternAt[i] >= 0) {
+                address += CALL_SIZE;
+                i += patterns[patternAt[i]].length;
+            } else {
+                address++;
+                i++;
+            }
+        }
+        newAddress[n] = static_cast<uint32_t>(address);
+        if (fallsOffEnd()) {
+            address += HALT_SIZE;
+        }
+        std::vector<uint32_t> subroutineAddress(patterns.size());
+        for (size_t p = 0; p < patterns.size(); p++) {
+            subroutineAddress[p] = static_cast<uint32_t>(address);
+            address += patterns[p].length + RETURN_SIZE;
+        }
+
+        constexpr uint16_t D_EQ_A = Code::C_PREFIX | Code::comp("A") | Code::dest("D");
+        constexpr uint16_t M_EQ_D = Code::C_PREFIX | Code::comp("D") | Code::dest("M");
+        constexpr uint16_t A_EQ_M = Code::C_PREFIX | Code::comp("M") | Code::dest("A");
+        constexpr uint16_t GOTO = Code::C_PREFIX | Code::comp("0") | Code::jump("JMP");
+        const uint16_t ret = static_cast<uint16_t>(returnRegister);
+
+        std::vector<uint16_t> output;
+        output.reserve(address);
+        auto copy = [&](size_t i) {
+            output.push_back(relocations.labelReference[i]
+                             ? static_cast<uint16_t>(newAddress[words[i]]) : words[i]);
+        };
+        for (size_t i = 0; i < n;) {
+            if (patternAt[i] >= 0) {
+                uint16_t back = static_cast<uint16_t>(output.size() + CALL_SIZE);
+                uint16_t target = static_cast<uint16_t>(subroutineAddress[patternAt[i]]);
+                output.insert(output.end(), {back, D_EQ_A, ret, M_EQ_D, target, GOTO});
+                i += patterns[patternAt[i]].length;
+            } else {
+                copy(i++);
+            }
+        }
+        if (fallsOffEnd()) {
+            output.insert(output.end(), {static_cast<uint16_t>(newAddress[n]), GOTO});
+        }
+        for (const Pattern& pattern : patterns) {
+            size_t source = pattern.sites[0];
+            for (size_t k = 0; k < pattern.length; k++) {
+                copy(source + k);
+            }
+            output.insert(output.end(), {ret, A_EQ_M, GOTO});
+        }
+        return output;
+    }
+
+public:
+    CodeCompressor(const std::vector<uint16_t>& words, const Relocations& relocations)
+        : words(words), relocations(relocations), covered(words.size(), false) {}
+
+    // 成功时返回压缩后的程序并填写 report；否则返回原程序，report.reason 说明原因
+    std::vector<uint16_t> compress(CompressionReport& report) {
+        size_t n = words.size();
+        report = CompressionReport();
+        report.originalSize = n;
+        report.compressedSize = n;
+
+        for (size_t i = 0; i + 1 < n; i++) {
+            if (!relocations.labelReference[i] && isA(i) && !isA(i + 1) && jumps(words[i + 1])) {
+                report.reason = "第 " + std::to_string(i) + " 条指令按绝对 ROM 地址跳转，无法重定位";
+                return words;
+            }
+        }
+        if (relocations.variableEnd >= VARIABLE_LIMIT) {
+            report.reason = "没有空闲的 RAM 单元存放返回地址";
+            return words;
+        }
+
+        std::vector<uint8_t> firstDWrite;
+        std::vector<uint8_t> maxLength = maxLengths(firstDWrite);
+        std::vector<bool> aDead;
+        std::vector<bool> dDead;
+        deadRegisters(aDead, dDead);
+        std::vector<Pattern> patterns;
+        for (int round = 0; round < MAX_ROUNDS; round++) {
+            if (searchRound(maxLength, firstDWrite, aDead, dDead, patterns) == 0) break;
+        }
+        if (patterns.empty()) {
+            report.reason = "没有找到值得抽取的重复序列";
+            return words;
+        }
+
+        report.applied = true;
+        report.returnRegister = relocations.variableEnd;
+        report.subroutines = patterns.size();
+        for (const Pattern& pattern : patterns) {
+            report.callSites += pattern.sites.size();
+        }
+        std::vector<uint16_t> output = rewrite(patterns, report.returnRegister);
+        report.compressedSize = output.size();
+        return output;
+    }
+};
+
+#endif
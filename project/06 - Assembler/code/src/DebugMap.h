@@ -0,0 +1,225 @@
+#ifndef DEBUGMAP_H
+#define DEBUGMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AsmLexer.h"
+
+// 调试映射 (.hmap)：ROM 地址 -> 源码位置，用于把模拟器按 PC 统计的计数还原到源码。
+// 每条指令记录它在 .asm 中的行号；所在标签和来源注释（VM 翻译器写出的 "// vm: ..."、
+// 编译器写出的 "// jack: ..."）都是连续的一段地址共用一个，按区间存放：
+// 区间从 start 开始，到下一个区间的 start 为止，查找时二分。
+//
+// 文件格式（整数均为小端序）：
+//     "HMAP"  u16 版本
+//     u32 指令数  u32 字符串数  u32 标签区间数  u32 vm 区间数  u32 jack 区间数
+//     字符串    { u16 长度, 内容 } × 字符串数（标签名和注释，去重）
+//     行号      u32 × 指令数
+//     区间      { u32 起始地址, u32 字符串下标 } × (标签区间数 + vm 区间数 + jack 区间数)
+struct DebugMap {
+    static constexpr uint16_t VERSION = 1;
+
+    struct Range {
+        uint32_t start;
+        uint32_t string;
+    };
+
+    std::vector<uint32_t> lines; // 按 ROM 地址：.asm 行号（从 1 开始）
+    std::vector<std::string> strings;
+    std::vector<Range> labels;
+    std::vector<Range> vm;
+    std::vector<Range> jack;
+
+    // 扫描源码生成映射，指令地址的计算与汇编器相同（见 LineScanner）
+    static DebugMap build(std::string_view source) {
+        DebugMap map;
+        std::unordered_map<std::string_view, uint32_t> stringIndex;
+        auto intern = [&](std::string_view text) {
+            auto found = stringIndex.find(text);
+            if (found != stringIndex.end()) return found->second;
+            uint32_t index = static_cast<uint32_t>(map.strings.size());
+            map.strings.emplace_back(text);
+            stringIndex.emplace(text, index);
+            return index;
+        };
+        // 同一地址上的多个来源注释以最后一个为准（它才描述后面的指令）
+        auto setRange = [](std::vector<Range>& ranges, uint32_t start, uint32_t string) {
+            if (!ranges.empty() && ranges.back().start == start) {
+                ranges.back().string = string;
+            } else if (ranges.empty() || ranges.back().string != string) {
+                ranges.push_back({start, string});
+            }
+        };
+
+        const char* cursor = source.data();
+        const char* limit = source.data() + source.size();
+        uint32_t lineNumber = 0;
+        while (cursor < limit) {
+            lineNumber++;
+            const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', limit - cursor));
+            const char* lineEnd = (newline != nullptr) ? newline : limit;
+            std::string_view line(cursor, lineEnd - cursor);
+            cursor = (newline != nullptr) ? newline + 1 : limit;
+
+            uint32_t address = static_cast<uint32_t>(map.lines.size());
+            size_t comment = line.find("//");
+            if (comment != std::string_view::npos) {
+                std::string_view text = trim(line.substr(comment + 2));
+                if (text.compare(0, 3, "vm:") == 0) {
+                    setRange(map.vm, address, intern(trim(text.substr(3))));
+                } else if (text.compare(0, 5, "jack:") == 0) {
+                    setRange(map.jack, address, intern(trim(text.substr(5))));
+                }
+            }
+
+            std::string_view instruction = trim(removeComments(line));
+            if (instruction.empty()) {
+                continue;
+            }
+            if (instruction[0] == '(') {
+                // 同一地址上有多个标签时保留第一个，通常是函数名
+                if (map.labels.empty() || map.labels.back().start != address) {
+                    map.labels.push_back({address, intern(instruction.substr(1, instruction.size() - 2))});
+                }
+            } else {
+                map.lines.push_back(lineNumber);
+            }
+        }
+        return map;
+    }
+
+    // 包含 address 的区间对应的字符串，没有时返回 nullptr
+    const std::string* find(const std::vector<Range>& ranges, uint32_t address) const {
+        auto after = std::upper_bound(ranges.begin(), ranges.end(), address,
+                                      [](uint32_t value, const Range& range) { return value < range.start; });
+        if (after == ranges.begin()) {
+            return nullptr;
+        }
+        return &strings[(after - 1)->string];
+    }
+
+    const std::string* label(uint32_t address) const {
+        return find(labels, address);
+    }
+
+    const std::string* vmCommand(uint32_t address) const {
+        return find(vm, address);
+    }
+
+    const std::string* jackSource(uint32_t address) const {
+        return find(jack, address);
+    }
+
+    std::string serialize() const {
+        std::string out;
+        out.reserve(26 + lines.size() * 4 + (labels.size() + vm.size() + jack.size()) * 8);
+        auto put16 = [&out](uint32_t value) {
+            out.push_back(static_cast<char>(value & 0xFF));
+            out.push_back(static_cast<char>((value >> 8) & 0xFF));
+        };
+        auto put32 = [&put16](uint32_t value) {
+            put16(value & 0xFFFF);
+            put16(value >> 16);
+        };
+
+        out += "HMAP";
+        put16(VERSION);
+        put32(static_cast<uint32_t>(lines.size()));
+        put32(static_cast<uint32_t>(strings.size()));
+        put32(static_cast<uint32_t>(labels.size()));
+        put32(static_cast<uint32_t>(vm.size()));
+        put32(static_cast<uint32_t>(jack.size()));
+        for (const std::string& text : strings) {
+            size_t length = std::min<size_t>(text.size(), 0xFFFF);
+            put16(static_cast<uint32_t>(length));
+            out.append(text, 0, length);
+        }
+        for (uint32_t line : lines) {
+            put32(line);
+        }
+        for (const std::vector<Range>* ranges : {&labels, &vm, &jack}) {
+            for (const Range& range : *ranges) {
+                put32(range.start);
+                put32(range.string);
+            }
+        }
+        return out;
+    }
+
+    // 解析并校验 .hmap 内容，失败时返回 false 并在 error 中说明原因
+    static bool parse(std::string_view data, DebugMap& map, std::string& error) {
+        size_t position = 0;
+        bool truncated = false;
+        auto need = [&](size_t size) {
+            if (data.size() - position < size) truncated = true;
+            return !truncated;
+        };
+        auto get16 = [&]() -> uint32_t {
+            if (!need(2)) return 0;
+            uint32_t value = static_cast<unsigned char>(data[position]) |
+                             static_cast<unsigned char>(data[position + 1]) << 8;
+            position += 2;
+            return value;
+        };
+        auto get32 = [&]() -> uint32_t {
+            uint32_t low = get16();
+            return low | get16() << 16;
+        };
+
+        if (data.substr(0, 4) != "HMAP") {
+            error = "不是 .hmap 文件";
+            return false;
+        }
+        position = 4;
+        if (get16() != VERSION) {
+            error = "不支持的 .hmap 版本";
+            return false;
+        }
+        uint32_t wordCount = get32();
+        uint32_t stringCount = get32();
+        uint32_t rangeCounts[3] = {get32(), get32(), get32()};
+        uint64_t rangeTotal = static_cast<uint64_t>(rangeCounts[0]) + rangeCounts[1] + rangeCounts[2];
+        // 先按最小记录长度检查一遍，避免损坏的计数导致巨量分配
+        if (truncated || !need(stringCount * 2ull + wordCount * 4ull + rangeTotal * 8)) {
+            error = "文件被截断";
+            return false;
+        }
+
+        map = DebugMap();
+        map.strings.resize(stringCount);
+        for (std::string& text : map.strings) {
+            uint32_t length = get16();
+            if (!need(length)) break;
+            text.assign(data.substr(position, length));
+            position += length;
+        }
+        map.lines.resize(wordCount);
+        for (uint32_t& line : map.lines) {
+            line = get32();
+        }
+        std::vector<Range>* ranges[3] = {&map.labels, &map.vm, &map.jack};
+        for (int kind = 0; kind < 3; kind++) {
+            ranges[kind]->resize(rangeCounts[kind]);
+            for (Range& range : *ranges[kind]) {
+                range.start = get32();
+                range.string = get32();
+                if (range.string >= stringCount || range.start > wordCount) {
+                    error = "区间越界";
+                    return false;
+                }
+            }
+        }
+        if (truncated) {
+            error = "文件被截断";
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
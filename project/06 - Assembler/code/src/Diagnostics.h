@@ -0,0 +1,54 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 汇编诊断信息：行号从 1 开始，0 表示与具体行无关（如程序超出 ROM）
+struct Diagnostic {
+    enum Severity {
+        WARNING,
+        ERROR
+    };
+
+    Severity severity;
+    size_t line;
+    std::string message;
+};
+
+struct Diagnostics {
+    std::vector<Diagnostic> messages;
+
+    void error(size_t line, const std::string& message) {
+        messages.push_back({Diagnostic::ERROR, line, message});
+    }
+
+    void warning(size_t line, const std::string& message) {
+        messages.push_back({Diagnostic::WARNING, line, message});
+    }
+
+    size_t errorCount() const {
+        size_t count = 0;
+        for (const Diagnostic& diagnostic : messages) {
+            if (diagnostic.severity == Diagnostic::ERROR) count++;
+        }
+        return count;
+    }
+
+    bool hasErrors() const {
+        return errorCount() > 0;
+    }
+
+    // 按 "文件:行: 错误: 信息" 的格式输出
+    void print(std::ostream& out, const std::string& fileName) const {
+        for (const Diagnostic& diagnostic : messages) {
+            out << fileName;
+            if (diagnostic.line > 0) out << ":" << diagnostic.line;
+            out << ": " << (diagnostic.severity == Diagnostic::ERROR ? "错误" : "警告")
+                << ": " << diagnostic.message << std::endl;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef HACKASSEMBLER_H
+#define HACKASSEMBLER_H
+
+// Hack 汇编器的库接口：直接在内存中汇编，不经过文件。
+// VM 翻译器、Jack 编译器等生成汇编的工具可以把生成的文本直接交给 assemble()，
+// 省去写出再读回中间 .asm 文件。只有头文件，使用时把本目录加入 include 路径：
+//
+//     #include "HackAssembler.h"
+//
+//     Diagnostics diagnostics;
+//     std::vector<uint16_t> rom = assemble(asmText, diagnostics);
+//     if (diagnostics.hasErrors()) diagnostics.print(std::cerr, "<generated>");
+//     HackWriter::write("Prog.hack", rom, OutputFormat::TEXT);
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Compressor.h"
+#include "Diagnostics.h"
+#include "HackWriter.h"
+#include "Linker.h"
+#include "ObjectFile.h"
+#include "ParallelAssembler.h"
+#include "SinglePass.h"
+
+struct AssembleOptions {
+    bool parallel = false; // 多线程汇编，适合很大的输入
+    unsigned threads = 0;  // 0 表示按 CPU 核心数
+};
+
+// 汇编整段源码，语法错误和警告写入 diagnostics。
+// 有错误时仍返回尽力编码的结果，调用方应先检查 diagnostics.hasErrors()
+inline std::vector<uint16_t> assemble(std::string_view source, Diagnostics& diagnostics,
+                                      const AssembleOptions& options = AssembleOptions()) {
+    if (options.parallel) {
+        return ParallelAssembler(options.threads).assemble(source, &diagnostics);
+    }
+    return SinglePassAssembler().assemble(source, &diagnostics);
+}
+
+// 不关心诊断信息时使用：不做语法检查，无效助记符按 0 编码
+inline std::vector<uint16_t> assemble(std::string_view source) {
+    return SinglePassAssembler().assemble(source);
+}
+
+// 汇编成可重定位目标文件，不分配变量、不解析其他模块的标签，之后交给 Linker 链接
+inline HackObject assembleObject(std::string_view source, Diagnostics& diagnostics) {
+    SinglePassAssembler::SourceScan scan;
+    SinglePassAssembler().scan(source, scan, &diagnostics);
+    return HackObject::fromScan(scan);
+}
+
+// 汇编后做链接期代码压缩（见 Compressor.h），压缩结果写入 report。
+// 需要完整的重定位信息，总是走单遍路径；ROM 容量按压缩后的长度检查
+inline std::vector<uint16_t> assembleCompressed(std::string_view source, Diagnostics& diagnostics,
+                                                CompressionReport& report) {
+    Relocations relocations;
+    std::vector<uint16_t> words = SinglePassAssembler().assemble(source, &diagnostics, &relocations);
+    if (!diagnostics.hasErrors()) {
+        words = CodeCompressor(words, relocations).compress(report);
+    }
+    checkRomSize(words.size(), &diagnostics);
+    return words;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef HACKWRITER_H
+#define HACKWRITER_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+enum class OutputFormat {
+    TEXT,   // .hack：每行 16 个 ASCII '0'/'1'
+    BINARY  // .bin：小端 16 位 ROM 镜像，模拟器可直接加载
+};
+
+// 每个字节对应的 8 个 ASCII 位，编译期生成
+struct HackByteTable {
+    std::array<std::array<char, 8>, 256> bits;
+
+    constexpr HackByteTable() : bits() {
+        for (int value = 0; value < 256; value++) {
+            for (int bit = 0; bit < 8; bit++) {
+                bits[value][bit] = ((value >> (7 - bit)) & 1) ? '1' : '0';
+            }
+        }
+    }
+};
+
+// 输出层：先把整个程序格式化到一块内存缓冲区，再用一次 write 写出
+class HackWriter {
+private:
+    static constexpr HackByteTable TABLE = HackByteTable();
+
+public:
+    // 把数据全部写入已打开的文件描述符（管道、标准输出等）。
+    // 通常一次 write 就能写完，只有被信号打断或部分写入时才会循环
+    static bool writeFully(int fd, const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // 把整块数据写入文件，.hobj 等其他输出也用它
+    static bool writeAll(const std::string& filename, const char* data, size_t length) {
+        int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = writeFully(fd, data, length);
+        return (close(fd) == 0) && ok;
+    }
+
+    static std::string extension(OutputFormat format) {
+        return (format == OutputFormat::BINARY) ? ".bin" : ".hack";
+    }
+
+    // 文本格式：行间用 '\n' 分隔，末尾不换行（与原输出一致）
+    static std::vector<char> formatText(const std::vector<uint16_t>& words) {
+        std::vector<char> buffer(words.empty() ? 0 : words.size() * 17 - 1);
+        char* out = buffer.data();
+        for (size_t i = 0; i < words.size(); i++) {
+            if (i > 0) *out++ = '\n';
+            const std::array<char, 8>& high = TABLE.bits[words[i] >> 8];
+            const std::array<char, 8>& low = TABLE.bits[words[i] & 0xFF];
+            for (int bit = 0; bit < 8; bit++) *out++ = high[bit];
+            for (int bit = 0; bit < 8; bit++) *out++ = low[bit];
+        }
+        return buffer;
+    }
+
+    // 二进制格式：每条指令 2 字节，低字节在前
+    static std::vector<char> formatBinary(const std::vector<uint16_t>& words) {
+        std::vector<char> buffer(words.size() * 2);
+        for (size_t i = 0; i < words.size(); i++) {
+            buffer[2 * i] = static_cast<char>(words[i] & 0xFF);
+            buffer[2 * i + 1] = static_cast<char>(words[i] >> 8);
+        }
+        return buffer;
+    }
+
+    // 逐条追加到缓冲区，供流式输出使用，拼起来与 format() 的结果相同；
+    // index 是这条指令在整个程序中的位置，文本格式在第一条之后才写行分隔符
+    static void append(std::string& out, uint16_t word, size_t index, OutputFormat outputFormat) {
+        if (outputFormat == OutputFormat::BINARY) {
+            out.push_back(static_cast<char>(word & 0xFF));
+            out.push_back(static_cast<char>(word >> 8));
+            return;
+        }
+        if (index > 0) out.push_back('\n');
+        out.append(TABLE.bits[word >> 8].data(), 8);
+        out.append(TABLE.bits[word & 0xFF].data(), 8);
+    }
+
+    static std::vector<char> format(const std::vector<uint16_t>& words, OutputFormat format) {
+        return (format == OutputFormat::BINARY) ? formatBinary(words) : formatText(words);
+    }
+
+    static bool write(const std::string& filename, const std::vector<uint16_t>& words,
+                      OutputFormat outputFormat) {
+        std::vector<char> buffer = format(words, outputFormat);
+        return writeAll(filename, buffer.data(), buffer.size());
+    }
+};
+
+#endif
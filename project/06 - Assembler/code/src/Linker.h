@@ -0,0 +1,93 @@
+#ifndef LINKER_H
+#define LINKER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Diagnostics.h"
+#include "ObjectFile.h"
+#include "SinglePass.h"
+#include "SymbolTable.h"
+
+// 链接器：按加入顺序把各模块依次排在 ROM 中，
+//   1. 对各模块指令数做前缀和得到基址，登记所有导出标签（重名时以后面的模块为准，并给出警告）
+//   2. 按模块顺序、模块内按指令顺序处理重定位：LOCAL 加上模块基址，
+//      EXTERNAL 解析为导出标签，找不到的按首次出现顺序从 RAM[16] 分配为变量
+// 模块之间没有重名标签时，结果与把各模块的 .asm 按同样顺序拼接后整体汇编逐字节相同。
+class Linker {
+private:
+    struct Module {
+        std::string name;
+        HackObject object;
+        size_t base = 0;
+    };
+
+    std::vector<Module> modules;
+
+public:
+    void add(const std::string& name, HackObject object) {
+        modules.push_back({name, std::move(object), 0});
+    }
+
+    size_t moduleCount() const {
+        return modules.size();
+    }
+
+    std::vector<uint16_t> link(Diagnostics& diagnostics) {
+        SymbolTable symbolTable;
+        std::vector<std::string> definedIn; // 按符号 id 记录定义标签的模块，用于重名警告
+
+        size_t total = 0;
+        for (Module& module : modules) {
+            module.base = total;
+            total += module.object.words.size();
+            for (const HackObject::Export& symbol : module.object.exports) {
+                uint32_t id = symbolTable.intern(symbol.name);
+                if (definedIn.size() <= id) definedIn.resize(id + 1);
+                if (!definedIn[id].empty()) {
+                    diagnostics.warning(0, "标签 " + symbol.name + " 在 " + definedIn[id] + " 和 " +
+                                           module.name + " 中重复定义，使用后者");
+                }
+                definedIn[id] = module.name;
+                symbolTable.address(id) = static_cast<int>(module.base + symbol.offset);
+            }
+        }
+
+        std::vector<uint16_t> words;
+        words.reserve(total);
+        int nextVariableAddress = VARIABLE_BASE;
+        for (const Module& module : modules) {
+            const HackObject& object = module.object;
+            words.insert(words.end(), object.words.begin(), object.words.end());
+            uint16_t* code = words.data() + module.base;
+
+            // 每个导入只在第一次用到时查一次符号表，保证变量分配顺序与源码顺序一致
+            std::vector<int> importAddress(object.imports.size(), SymbolTable::UNRESOLVED);
+            for (const HackObject::Relocation& relocation : object.relocations) {
+                if (relocation.kind == HackObject::LOCAL) {
+                    code[relocation.index] = static_cast<uint16_t>(code[relocation.index] + module.base);
+                    continue;
+                }
+                int& resolved = importAddress[relocation.symbol];
+                if (resolved == SymbolTable::UNRESOLVED) {
+                    int& address = symbolTable.lookupOrInsert(object.imports[relocation.symbol]);
+                    if (address == SymbolTable::UNRESOLVED) {
+                        if (nextVariableAddress == VARIABLE_LIMIT) {
+                            diagnostics.warning(0, "变量过多，" + object.imports[relocation.symbol] +
+                                                   " 已分配到 RAM[16384] (SCREEN) 及之后");
+                        }
+                        address = nextVariableAddress++;
+                    }
+                    resolved = address;
+                }
+                code[relocation.index] = static_cast<uint16_t>(resolved);
+            }
+        }
+
+        checkRomSize(words.size(), &diagnostics);
+        return words;
+    }
+};
+
+#endif
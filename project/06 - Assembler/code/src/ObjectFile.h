@@ -0,0 +1,210 @@
+#ifndef OBJECTFILE_H
+#define OBJECTFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SinglePass.h"
+
+// 可重定位目标文件 (.hobj)：一个 .asm 模块汇编后、链接前的形式。
+// 模块内的标签引用保存模块内地址，链接时加上模块基址（LOCAL 重定位）；
+// 模块内没有定义的符号记为导入（EXTERNAL 重定位），链接时解析为其他模块导出的标签，
+// 都找不到的按首次出现顺序分配为变量。预定义符号和数字常量在汇编时就已确定。
+//
+// 文件格式（整数均为小端序）：
+//     "HOBJ"  u16 版本
+//     u32 指令数  u32 导出数  u32 导入数  u32 重定位数
+//     指令      u16 × 指令数
+//     导出      { u32 模块内地址, u16 名字长度, 名字 } × 导出数
+//     导入      { u16 名字长度, 名字 } × 导入数
+//     重定位    { u32 指令下标, u8 类型, u32 符号下标 } × 重定位数
+struct HackObject {
+    static constexpr uint16_t VERSION = 1;
+
+    enum RelocationKind : uint8_t {
+        LOCAL = 0,   // 指令中是模块内地址，symbol 为导出下标
+        EXTERNAL = 1 // 指令中是 0，symbol 为导入下标
+    };
+
+    struct Export {
+        std::string name;
+        uint32_t offset;
+    };
+
+    struct Relocation {
+        uint32_t index;
+        RelocationKind kind;
+        uint32_t symbol;
+    };
+
+    std::vector<uint16_t> words;
+    std::vector<Export> exports;
+    std::vector<std::string> imports;
+    std::vector<Relocation> relocations; // 按指令顺序
+
+    // 由单遍扫描的结果生成目标文件
+    static HackObject fromScan(const SinglePassAssembler::SourceScan& scan) {
+        HackObject object;
+        object.words = scan.words;
+        const SymbolTable& symbolTable = scan.symbolTable;
+
+        std::vector<uint32_t> exportIndex(symbolTable.size(), UINT32_MAX);
+        std::vector<uint32_t> importIndex(symbolTable.size(), UINT32_MAX);
+        for (uint32_t id = 0; id < symbolTable.size(); id++) {
+            if (scan.definesLabel(id)) {
+                exportIndex[id] = static_cast<uint32_t>(object.exports.size());
+                object.exports.push_back({std::string(symbolTable.name(id)),
+                                          static_cast<uint32_t>(symbolTable.address(id))});
+            }
+        }
+
+        for (const SinglePassAssembler::Fixup& fixup : scan.fixups) {
+            uint32_t index = static_cast<uint32_t>(fixup.index);
+            if (scan.definesLabel(fixup.symbol)) {
+                object.words[index] = static_cast<uint16_t>(symbolTable.address(fixup.symbol));
+                object.relocations.push_back({index, LOCAL, exportIndex[fixup.symbol]});
+            } else if (SymbolTable::isPredefined(fixup.symbol)) {
+                object.words[index] = static_cast<uint16_t>(symbolTable.address(fixup.symbol));
+            } else {
+                if (importIndex[fixup.symbol] == UINT32_MAX) {
+                    importIndex[fixup.symbol] = static_cast<uint32_t>(object.imports.size());
+                    object.imports.push_back(std::string(symbolTable.name(fixup.symbol)));
+                }
+                object.relocations.push_back({index, EXTERNAL, importIndex[fixup.symbol]});
+            }
+        }
+        return object;
+    }
+
+    std::string serialize() const {
+        std::string out;
+        out.reserve(22 + words.size() * 2 + relocations.size() * 9);
+        auto put16 = [&out](uint32_t value) {
+            out.push_back(static_cast<char>(value & 0xFF));
+            out.push_back(static_cast<char>((value >> 8) & 0xFF));
+        };
+        auto put32 = [&put16](uint32_t value) {
+            put16(value & 0xFFFF);
+            put16(value >> 16);
+        };
+        auto putName = [&out, &put16](const std::string& name) {
+            put16(static_cast<uint32_t>(name.size()));
+            out += name;
+        };
+
+        out += "HOBJ";
+        put16(VERSION);
+        put32(static_cast<uint32_t>(words.size()));
+        put32(static_cast<uint32_t>(exports.size()));
+        put32(static_cast<uint32_t>(imports.size()));
+        put32(static_cast<uint32_t>(relocations.size()));
+        for (uint16_t word : words) {
+            put16(word);
+        }
+        for (const Export& symbol : exports) {
+            put32(symbol.offset);
+            putName(symbol.name);
+        }
+        for (const std::string& name : imports) {
+            putName(name);
+        }
+        for (const Relocation& relocation : relocations) {
+            put32(relocation.index);
+            out.push_back(static_cast<char>(relocation.kind));
+            put32(relocation.symbol);
+        }
+        return out;
+    }
+
+    // 解析并校验 .hobj 内容，失败时返回 false 并在 error 中说明原因
+    static bool parse(std::string_view data, HackObject& object, std::string& error) {
+        size_t position = 0;
+        bool truncated = false;
+        auto need = [&](size_t size) {
+            if (data.size() - position < size) truncated = true;
+            return !truncated;
+        };
+        auto get16 = [&]() -> uint32_t {
+            if (!need(2)) return 0;
+            uint32_t value = static_cast<unsigned char>(data[position]) |
+                             static_cast<unsigned char>(data[position + 1]) << 8;
+            position += 2;
+            return value;
+        };
+        auto get32 = [&]() -> uint32_t {
+            uint32_t low = get16();
+            return low | get16() << 16;
+        };
+        auto getName = [&]() -> std::string {
+            uint32_t length = get16();
+            if (!need(length)) return std::string();
+            std::string name(data.substr(position, length));
+            position += length;
+            return name;
+        };
+
+        if (data.substr(0, 4) != "HOBJ") {
+            error = "不是 .hobj 文件";
+            return false;
+        }
+        position = 4;
+        if (get16() != VERSION) {
+            error = "不支持的 .hobj 版本";
+            return false;
+        }
+        uint32_t wordCount = get32();
+        uint32_t exportCount = get32();
+        uint32_t importCount = get32();
+        uint32_t relocationCount = get32();
+        // 先按最小记录长度检查一遍，避免损坏的计数导致巨量分配
+        if (truncated || !need(wordCount * 2ull + exportCount * 6ull + importCount * 2ull + relocationCount * 9ull)) {
+            error = "文件被截断";
+            return false;
+        }
+
+        object = HackObject();
+        object.words.resize(wordCount);
+        for (uint16_t& word : object.words) {
+            word = static_cast<uint16_t>(get16());
+        }
+        object.exports.resize(exportCount);
+        for (Export& symbol : object.exports) {
+            symbol.offset = get32();
+            symbol.name = getName();
+        }
+        object.imports.resize(importCount);
+        for (std::string& name : object.imports) {
+            name = getName();
+        }
+        object.relocations.resize(relocationCount);
+        for (Relocation& relocation : object.relocations) {
+            relocation.index = get32();
+            relocation.kind = need(1) ? static_cast<RelocationKind>(data[position++]) : LOCAL;
+            relocation.symbol = get32();
+        }
+        if (truncated) {
+            error = "文件被截断";
+            return false;
+        }
+
+        for (const Export& symbol : object.exports) {
+            if (symbol.offset > wordCount) {
+                error = "导出符号 " + symbol.name + " 的地址越界";
+                return false;
+            }
+        }
+        for (const Relocation& relocation : object.relocations) {
+            bool valid = relocation.index < wordCount &&
+                         ((relocation.kind == LOCAL && object.words[relocation.index] <= wordCount) ||
+                          (relocation.kind == EXTERNAL && relocation.symbol < importCount));
+            if (!valid) {
+                error = "重定位项越界";
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
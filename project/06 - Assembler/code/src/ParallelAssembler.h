@@ -0,0 +1,231 @@
+#ifndef PARALLELASSEMBLER_H
+#define PARALLELASSEMBLER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "AsmLexer.h"
+#include "Diagnostics.h"
+#include "SinglePass.h"
+#include "SymbolTable.h"
+
+// 多线程汇编器：把源码按行边界切成若干块，分三个阶段完成汇编
+//   1. 并行：各块独立扫描，编码 C 指令、数字和预定义符号，记录块内的标签和符号引用
+//   2. 串行：对各块指令数做前缀和得到 ROM 基址，登记标签，
+//      再按源码顺序解析符号引用，变量仍按首次出现顺序从 RAM[16] 分配
+//   3. 并行：各块把机器码复制到最终输出的对应位置
+// 输出与串行路径逐字节相同。
+class ParallelAssembler {
+private:
+    // 小于这个大小的块不值得再切分
+    static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+    struct LabelDef {
+        std::string_view name;
+        uint32_t index; // 块内下一条指令的位置
+        uint32_t line;  // 块内行号
+    };
+
+    struct Reference {
+        uint32_t index; // 块内待回填指令的位置
+        uint32_t line;  // 块内行号
+        std::string_view symbol;
+    };
+
+    struct Chunk {
+        std::string_view source;
+        std::vector<uint16_t> words;
+        std::vector<LabelDef> labels;
+        std::vector<Reference> references;
+        Diagnostics diagnostics; // 行号为块内行号
+        size_t lineCount = 0;
+        size_t base = 0;     // 块内第一条指令的 ROM 地址
+        size_t lineBase = 0; // 块首行之前的行数
+    };
+
+    unsigned threadCount;
+    SymbolTable symbolTable;
+
+    // 按行边界把源码切成至多 parts 块
+    static std::vector<std::string_view> split(std::string_view source, unsigned parts) {
+        std::vector<std::string_view> pieces;
+        size_t target = source.size() / parts;
+        if (target < MIN_CHUNK_SIZE) target = MIN_CHUNK_SIZE;
+
+        size_t start = 0;
+        while (start < source.size()) {
+            size_t end = start + target;
+            if (end >= source.size()) {
+                end = source.size();
+            } else {
+                const void* newline = std::memchr(source.data() + end, '\n', source.size() - end);
+                end = (newline != nullptr)
+                    ? static_cast<const char*>(newline) - source.data() + 1
+                    : source.size();
+            }
+            pieces.push_back(source.substr(start, end - start));
+            start = end;
+        }
+        return pieces;
+    }
+
+    // 阶段 1：只读访问符号表（此时表中只有预定义符号），可以多线程同时执行
+    void scanChunk(Chunk& chunk, bool check) const {
+        chunk.words.reserve(chunk.source.size() / 8);
+        LineScanner scanner(chunk.source);
+        std::string_view line;
+
+        while (scanner.next(line)) {
+            uint32_t lineNumber = static_cast<uint32_t>(scanner.lineNumber());
+            if (line[0] == '(') {
+                if (check) {
+                    if (const char* error = checkLabel(line)) {
+                        chunk.diagnostics.error(lineNumber, error);
+                    }
+                }
+                chunk.labels.push_back({line.substr(1, line.size() - 2),
+                                        static_cast<uint32_t>(chunk.words.size()), lineNumber});
+            } else if (line[0] == '@') {
+                std::string_view symbol = line.substr(1);
+                if (check) {
+                    if (const char* error = checkAOperand(symbol)) {
+                        chunk.diagnostics.error(lineNumber, error);
+                    }
+                }
+                if (isNumber(symbol)) {
+                    chunk.words.push_back(parseNumber(symbol));
+                } else {
+                    int address = symbolTable.find(symbol);
+                    if (address != SymbolTable::UNRESOLVED) {
+                        chunk.words.push_back(static_cast<uint16_t>(address));
+                    } else {
+                        chunk.references.push_back({static_cast<uint32_t>(chunk.words.size()), lineNumber, symbol});
+                        chunk.words.push_back(0);
+                    }
+                }
+            } else {
+                const char* error = nullptr;
+                chunk.words.push_back(encodeCInstruction(line, check ? &error : nullptr));
+                if (error != nullptr) {
+                    chunk.diagnostics.error(lineNumber, error);
+                }
+            }
+        }
+        chunk.lineCount = scanner.lineNumber();
+    }
+
+    template <typename Fn>
+    void forEachChunk(std::vector<Chunk>& chunks, Fn fn) {
+        if (chunks.size() == 1) {
+            fn(chunks[0]);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(chunks.size());
+        for (Chunk& chunk : chunks) {
+            workers.emplace_back([&fn, &chunk]() { fn(chunk); });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+public:
+    explicit ParallelAssembler(unsigned threads = 0) : threadCount(threads) {
+        if (threadCount == 0) {
+            threadCount = std::thread::hardware_concurrency();
+        }
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+
+    // diagnostics 为空时不做语法检查，与 SinglePassAssembler 相同
+    std::vector<uint16_t> assemble(std::string_view source, Diagnostics* diagnostics = nullptr) {
+        std::vector<Chunk> chunks;
+        for (std::string_view piece : split(source, threadCount)) {
+            chunks.emplace_back();
+            chunks.back().source = piece;
+        }
+        if (chunks.empty()) {
+            return {};
+        }
+
+        // 阶段 1：并行扫描
+        bool check = (diagnostics != nullptr);
+        forEachChunk(chunks, [this, check](Chunk& chunk) { scanChunk(chunk, check); });
+
+        // 阶段 2：前缀和求基址，登记标签，再按源码顺序解析引用
+        size_t total = 0;
+        size_t totalLines = 0;
+        bool shadowsPredefined = false;
+        Diagnostics labelDiagnostics;
+        for (Chunk& chunk : chunks) {
+            chunk.base = total;
+            chunk.lineBase = totalLines;
+            total += chunk.words.size();
+            totalLines += chunk.lineCount;
+            for (const LabelDef& label : chunk.labels) {
+                uint32_t id = symbolTable.intern(label.name);
+                shadowsPredefined |= SymbolTable::isPredefined(id);
+                if (check && !SymbolTable::isPredefined(id) &&
+                    symbolTable.address(id) != SymbolTable::UNRESOLVED) {
+                    labelDiagnostics.warning(chunk.lineBase + label.line,
+                                             "标签重复定义 " + std::string(label.name));
+                }
+                symbolTable.address(id) = static_cast<int>(chunk.base + label.index);
+            }
+        }
+
+        // 标签覆盖了预定义符号时，阶段 1 已按预定义地址编码的引用就不对了，
+        // 这种罕见情况退回单遍路径
+        if (shadowsPredefined) {
+            return SinglePassAssembler().assemble(source, diagnostics);
+        }
+
+        if (check) {
+            for (const Chunk& chunk : chunks) {
+                for (const Diagnostic& diagnostic : chunk.diagnostics.messages) {
+                    diagnostics->messages.push_back(diagnostic);
+                    diagnostics->messages.back().line += chunk.lineBase;
+                }
+            }
+            for (const Diagnostic& diagnostic : labelDiagnostics.messages) {
+                diagnostics->messages.push_back(diagnostic);
+            }
+        }
+
+        int nextVariableAddress = VARIABLE_BASE;
+        for (Chunk& chunk : chunks) {
+            for (const Reference& reference : chunk.references) {
+                int& address = symbolTable.lookupOrInsert(reference.symbol);
+                if (address == SymbolTable::UNRESOLVED) {
+                    if (check && nextVariableAddress == VARIABLE_LIMIT) {
+                        diagnostics->warning(chunk.lineBase + reference.line,
+                                             "变量过多，已分配到 RAM[16384] (SCREEN) 及之后");
+                    }
+                    address = nextVariableAddress++;
+                }
+                chunk.words[reference.index] = static_cast<uint16_t>(address);
+            }
+        }
+
+        checkRomSize(total, diagnostics);
+
+        // 阶段 3：并行拼接
+        std::vector<uint16_t> words(total);
+        forEachChunk(chunks, [&words](Chunk& chunk) {
+            if (!chunk.words.empty()) {
+                std::memcpy(words.data() + chunk.base, chunk.words.data(),
+                            chunk.words.size() * sizeof(uint16_t));
+            }
+        });
+
+        return words;
+    }
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef SINGLEPASS_H
+#define SINGLEPASS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "AsmLexer.h"
+#include "Diagnostics.h"
+#include "SymbolTable.h"
+
+// Hack 平台的容量限制
+inline constexpr size_t ROM_SIZE = 32768;
+inline constexpr int VARIABLE_BASE = 16;
+inline constexpr int VARIABLE_LIMIT = 16384; // SCREEN 之前
+
+inline void checkRomSize(size_t size, Diagnostics* diagnostics) {
+    if (diagnostics != nullptr && size > ROM_SIZE) {
+        diagnostics->error(0, "程序长度 " + std::to_string(size) + " 超出 32K ROM");
+    }
+}
+
+// 重定位信息：汇编之后还要移动指令的优化（如 Compressor.h 的代码压缩）需要知道
+// 哪些 A 指令装入的是标签地址、哪些位置是标签，以及变量用到了哪里
+struct Relocations {
+    std::vector<bool> labelReference; // 按指令下标：是否是对标签（ROM 地址）的引用
+    std::vector<bool> labelTarget;    // 按 ROM 地址：是否有标签指向这里，长度为指令数 + 1
+    int variableEnd = VARIABLE_BASE;  // 下一个可分配的变量地址
+};
+
+// 单遍汇编器：在整块源码（通常是内存映射的 .asm 文件）上只扫描一次，
+// 所有记号都是指向源码的 string_view，逐行处理时不做堆分配。
+// 符号引用只驻留一次并记入回填表（fixup），扫描结束后统一回填：
+// 届时已有地址的符号（预定义符号、标签）直接填入，其余按首次出现顺序
+// 从 RAM[16] 分配为变量，结果与两遍扫描完全一致。
+class SinglePassAssembler {
+public:
+    struct Fixup {
+        size_t index;    // 待回填指令在输出中的位置
+        uint32_t symbol; // 符号表中的 id
+        size_t line;     // 引用所在行，用于诊断
+    };
+
+    // 扫描结果：已编码的指令（符号引用处为 0）、符号表和回填表，
+    // 回填之前也可以直接转换成可重定位目标文件（见 ObjectFile.h）
+    struct SourceScan {
+        SymbolTable symbolTable;
+        std::vector<Fixup> fixups;
+        std::vector<uint16_t> words;
+        std::vector<bool> isLabel;          // 按符号 id
+        std::vector<size_t> labelAddresses; // 每次标签定义的地址
+
+        bool definesLabel(uint32_t id) const {
+            return id < isLabel.size() && isLabel[id];
+        }
+    };
+
+    // 只扫描不回填；diagnostics 为空时不做语法检查
+    void scan(std::string_view source, SourceScan& result, Diagnostics* diagnostics = nullptr) {
+        SymbolTable& symbolTable = result.symbolTable;
+        std::vector<Fixup>& fixups = result.fixups;
+        std::vector<uint16_t>& words = result.words;
+        // 粗略预估指令数，避免频繁扩容
+        words.reserve(source.size() / 8);
+
+        LineScanner scanner(source);
+        std::string_view line;
+
+        while (scanner.next(line)) {
+            if (line[0] == '(') {
+                // 标签声明，记录下一条指令的地址
+                std::string_view name = line.substr(1, line.size() - 2);
+                uint32_t id = symbolTable.intern(name);
+                if (diagnostics != nullptr) {
+                    if (const char* error = checkLabel(line)) {
+                        diagnostics->error(scanner.lineNumber(), error);
+                    } else if (SymbolTable::isPredefined(id)) {
+                        diagnostics->warning(scanner.lineNumber(), "标签覆盖了预定义符号 " + std::string(name));
+                    } else if (symbolTable.address(id) != SymbolTable::UNRESOLVED) {
+                        diagnostics->warning(scanner.lineNumber(), "标签重复定义 " + std::string(name));
+                    }
+                }
+                symbolTable.address(id) = static_cast<int>(words.size());
+                if (result.isLabel.size() <= id) result.isLabel.resize(id + 1, false);
+                result.isLabel[id] = true;
+                result.labelAddresses.push_back(words.size());
+            } else if (line[0] == '@') {
+                std::string_view symbol = line.substr(1);
+                if (diagnostics != nullptr) {
+                    if (const char* error = checkAOperand(symbol)) {
+                        diagnostics->error(scanner.lineNumber(), error);
+                    }
+                }
+                if (isNumber(symbol)) {
+                    words.push_back(parseNumber(symbol));
+                } else {
+                    // 符号引用一律记入回填表：标签可能在后面才定义、被重复定义
+                    // 或覆盖预定义符号，都以最后一次定义为准（与两遍扫描一致）
+                    fixups.push_back({words.size(), symbolTable.intern(symbol), scanner.lineNumber()});
+                    words.push_back(0);
+                }
+            } else {
+                const char* error = nullptr;
+                words.push_back(encodeCInstruction(line, diagnostics != nullptr ? &error : nullptr));
+                if (error != nullptr) {
+                    diagnostics->error(scanner.lineNumber(), error);
+                }
+            }
+        }
+    }
+
+    // diagnostics 为空时不做语法检查，只按最初的宽松规则编码；
+    // relocations 非空时同时记录重定位信息
+    std::vector<uint16_t> assemble(std::string_view source, Diagnostics* diagnostics = nullptr,
+                                   Relocations* relocations = nullptr) {
+        SourceScan result;
+        scan(source, result, diagnostics);
+        SymbolTable& symbolTable = result.symbolTable;
+        std::vector<uint16_t>& words = result.words;
+
+        // 回填：按源码顺序处理，保证变量分配顺序与两遍扫描一致
+        int nextVariableAddress = VARIABLE_BASE;
+        for (const Fixup& fixup : result.fixups) {
+            int& address = symbolTable.address(fixup.symbol);
+            if (address == SymbolTable::UNRESOLVED) {
+                if (diagnostics != nullptr && nextVariableAddress == VARIABLE_LIMIT) {
+                    diagnostics->warning(fixup.line, "变量过多，已分配到 RAM[16384] (SCREEN) 及之后");
+                }
+                address = nextVariableAddress++;
+            }
+            words[fixup.index] = static_cast<uint16_t>(address);
+        }
+
+        if (relocations != nullptr) {
+            relocations->labelReference.assign(words.size(), false);
+            for (const Fixup& fixup : result.fixups) {
+                if (result.definesLabel(fixup.symbol)) {
+                    relocations->labelReference[fixup.index] = true;
+                }
+            }
+            relocations->labelTarget.assign(words.size() + 1, false);
+            for (size_t address : result.labelAddresses) {
+                relocations->labelTarget[address] = true;
+            }
+            relocations->variableEnd = nextVariableAddress;
+        }
+
+        // 调用方还要移动指令时，由调用方在最后检查 ROM 容量
+        if (relocations == nullptr) {
+            checkRomSize(words.size(), diagnostics);
+        }
+
+        return std::move(words);
+    }
+};
+
+#endif
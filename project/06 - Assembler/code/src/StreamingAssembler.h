@@ -0,0 +1,244 @@
+#ifndef STREAMINGASSEMBLER_H
+#define STREAMINGASSEMBLER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+#include "AsmLexer.h"
+#include "Diagnostics.h"
+#include "HackWriter.h"
+#include "SinglePass.h"
+#include "SymbolTable.h"
+
+// 流式汇编器：从文件描述符（通常是标准输入）逐块读入源码，边读边把机器码写到另一个
+// 文件描述符（通常是标准输出），用于 VMTranslator | assembler - | 模拟器 这样的管道。
+// 内存中只保留符号表、尚未解析的前向引用，以及从第一条未解析的指令开始、还不能输出的指令：
+//   - 预定义符号、已定义的标签和数字常量立即编码；
+//   - 引用还没有地址的符号时先留空，等标签定义出现时回填；
+//   - 输出必须按顺序，所以第一条未解析的指令之前的部分才能写出。
+// 变量要到输入结束才能确定（之后仍可能出现同名标签），引用变量的指令会把其后的输出
+// 一直挡到 EOF；跳到后面定义的标签同样要等到标签出现。VM 翻译器的输出（启动代码调用最后定义的
+// Sys.init，很早就引用 static 变量）几乎整个程序都要等待，占用的内存与普通单遍汇编相当，
+// 所以这不是有界内存的模式，只是省去了中间文件。
+// 与整体汇编的差别：标签重复定义或覆盖预定义符号时，已经输出的引用用的是旧地址（会给出警告）。
+// 出现第一个错误（或超出 32K ROM）后不再输出，丢弃尚未写出的部分，继续扫描只为报告其余的错误。
+class StreamingAssembler {
+private:
+    static constexpr size_t READ_SIZE = 64 * 1024;
+    static constexpr size_t WRITE_SIZE = 64 * 1024;
+
+    OutputFormat format;
+    int output;
+    bool writeFailed = false;
+    bool stopped = false; // 出现错误后不再输出
+
+    SymbolTable symbolTable;
+    std::vector<std::vector<size_t>> waiting; // 按符号 id：等待该符号地址的指令的 ROM 地址
+    std::vector<uint32_t> firstUnresolved;    // 首次被引用时还没有地址的符号，按出现顺序
+    std::vector<bool> queued;                 // 按符号 id：是否已在 firstUnresolved 中
+
+    std::vector<uint16_t> window;  // 还不能输出的指令，window[0] 的 ROM 地址为 windowBase
+    std::vector<bool> pending;     // 与 window 对应：是否还在等待回填
+    size_t windowHead = 0;         // window 中已输出部分的长度
+    size_t windowBase = 0;
+    size_t nextAddress = 0;        // 下一条指令的 ROM 地址
+    size_t peakWindow = 0;
+
+    std::string outputBuffer;
+
+    void emit(uint16_t word, size_t index) {
+        if (stopped) {
+            return;
+        }
+        HackWriter::append(outputBuffer, word, index, format);
+        if (outputBuffer.size() >= WRITE_SIZE) {
+            flushOutput();
+        }
+    }
+
+    void flushOutput() {
+        if (!outputBuffer.empty()) {
+            writeFailed |= !HackWriter::writeFully(output, outputBuffer.data(), outputBuffer.size());
+            outputBuffer.clear();
+        }
+    }
+
+    void fail(Diagnostics& diagnostics, size_t lineNumber, const char* error) {
+        diagnostics.error(lineNumber, error);
+        stopped = true;
+        outputBuffer.clear();
+    }
+
+    // 输出窗口开头已经解析的指令，已输出的部分超过一半时再整体前移
+    void drain() {
+        while (windowHead < window.size() && !pending[windowHead]) {
+            emit(window[windowHead], windowBase + windowHead);
+            windowHead++;
+        }
+        if (windowHead == window.size()) {
+            windowBase += windowHead;
+            window.clear();
+            pending.clear();
+            windowHead = 0;
+        } else if (windowHead * 2 > window.size()) {
+            window.erase(window.begin(), window.begin() + windowHead);
+            pending.erase(pending.begin(), pending.begin() + windowHead);
+            windowBase += windowHead;
+            windowHead = 0;
+        }
+    }
+
+    void push(uint16_t word, bool unresolved) {
+        if (nextAddress == ROM_SIZE) {
+            stopped = true; // 超出 ROM，结束时由 checkRomSize 报错
+            outputBuffer.clear();
+        }
+        if (!unresolved && window.empty()) {
+            emit(word, nextAddress); // 前面没有等待回填的指令，直接输出
+            windowBase = ++nextAddress;
+            return;
+        }
+        window.push_back(word);
+        pending.push_back(unresolved);
+        nextAddress++;
+        if (window.size() - windowHead > peakWindow) {
+            peakWindow = window.size() - windowHead;
+        }
+    }
+
+    void resolve(uint32_t id, int address) {
+        if (id >= waiting.size()) {
+            return;
+        }
+        for (size_t romAddress : waiting[id]) {
+            window[romAddress - windowBase] = static_cast<uint16_t>(address);
+            pending[romAddress - windowBase] = false;
+        }
+        std::vector<size_t>().swap(waiting[id]);
+    }
+
+    void processLine(std::string_view line, size_t lineNumber, Diagnostics& diagnostics) {
+        if (line[0] == '(') {
+            std::string_view name = line.substr(1, line.size() - 2);
+            uint32_t id = symbolTable.intern(name);
+            if (const char* error = checkLabel(line)) {
+                fail(diagnostics, lineNumber, error);
+            } else if (SymbolTable::isPredefined(id)) {
+                diagnostics.warning(lineNumber, "标签覆盖了预定义符号 " + std::string(name) +
+                                                "（流式模式下此前的引用仍使用预定义地址）");
+            } else if (symbolTable.address(id) != SymbolTable::UNRESOLVED) {
+                diagnostics.warning(lineNumber, "标签重复定义 " + std::string(name) +
+                                                "（流式模式下此前的引用仍使用第一次定义）");
+            }
+            symbolTable.address(id) = static_cast<int>(nextAddress);
+            resolve(id, static_cast<int>(nextAddress));
+            drain();
+        } else if (line[0] == '@') {
+            std::string_view symbol = line.substr(1);
+            if (const char* error = checkAOperand(symbol)) {
+                fail(diagnostics, lineNumber, error);
+            }
+            if (isNumber(symbol)) {
+                push(parseNumber(symbol), false);
+                return;
+            }
+            uint32_t id = symbolTable.intern(symbol);
+            int address = symbolTable.address(id);
+            if (address != SymbolTable::UNRESOLVED) {
+                push(static_cast<uint16_t>(address), false);
+                return;
+            }
+            if (waiting.size() <= id) {
+                waiting.resize(id + 1);
+                queued.resize(id + 1, false);
+            }
+            if (!queued[id]) {
+                // 变量按首次出现的顺序分配
+                queued[id] = true;
+                firstUnresolved.push_back(id);
+            }
+            waiting[id].push_back(nextAddress);
+            push(0, true);
+        } else {
+            const char* error = nullptr;
+            uint16_t word = encodeCInstruction(line, &error);
+            if (error != nullptr) {
+                fail(diagnostics, lineNumber, error); // 先停止输出，不写出无效的指令
+            }
+            push(word, false);
+        }
+    }
+
+public:
+    StreamingAssembler(int outputFd, OutputFormat outputFormat) : format(outputFormat), output(outputFd) {}
+
+    // 读到 EOF 为止；读写失败返回 false，语法错误写入 diagnostics
+    bool assemble(int inputFd, Diagnostics& diagnostics) {
+        std::string buffer;
+        std::vector<char> chunk(READ_SIZE);
+        size_t lineBase = 0;
+
+        while (true) {
+            ssize_t count = read(inputFd, chunk.data(), chunk.size());
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (count == 0) break;
+            buffer.append(chunk.data(), static_cast<size_t>(count));
+
+            // 只处理完整的行，最后不完整的一行留到下一块
+            size_t end = buffer.rfind('\n');
+            if (end == std::string::npos) continue;
+            LineScanner scanner(std::string_view(buffer.data(), end + 1));
+            std::string_view line;
+            while (scanner.next(line)) {
+                processLine(line, lineBase + scanner.lineNumber(), diagnostics);
+            }
+            lineBase += std::count(buffer.data(), buffer.data() + end + 1, '\n');
+            buffer.erase(0, end + 1);
+            drain();
+            flushOutput(); // 每读完一块就把能确定的输出交给下游
+        }
+
+        LineScanner scanner(buffer);
+        std::string_view line;
+        while (scanner.next(line)) {
+            processLine(line, lineBase + scanner.lineNumber(), diagnostics);
+        }
+
+        // 输入结束：仍未解析的符号按首次出现顺序分配为变量
+        int nextVariableAddress = VARIABLE_BASE;
+        for (uint32_t id : firstUnresolved) {
+            if (symbolTable.address(id) != SymbolTable::UNRESOLVED) {
+                continue; // 后来定义成了标签
+            }
+            if (nextVariableAddress == VARIABLE_LIMIT) {
+                diagnostics.warning(0, "变量过多，已分配到 RAM[16384] (SCREEN) 及之后");
+            }
+            symbolTable.address(id) = nextVariableAddress++;
+            resolve(id, symbolTable.address(id));
+        }
+        drain();
+        flushOutput();
+
+        checkRomSize(nextAddress, &diagnostics);
+        return !writeFailed;
+    }
+
+    size_t wordCount() const {
+        return nextAddress;
+    }
+
+    // 等待输出的指令数的峰值，反映流式模式实际占用的内存
+    size_t peakBuffered() const {
+        return peakWindow;
+    }
+};
+
+#endif
@@ -1,51 +1,210 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
-#include <string>
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
 
+struct PredefinedSymbol {
+    const char* name;
+    int address;
+};
+
+// 预定义符号
+inline constexpr PredefinedSymbol PREDEFINED_SYMBOLS[] = {
+    {"SP", 0}, {"LCL", 1}, {"ARG", 2}, {"THIS", 3}, {"THAT", 4},
+    {"R0", 0}, {"R1", 1}, {"R2", 2}, {"R3", 3},
+    {"R4", 4}, {"R5", 5}, {"R6", 6}, {"R7", 7},
+    {"R8", 8}, {"R9", 9}, {"R10", 10}, {"R11", 11},
+    {"R12", 12}, {"R13", 13}, {"R14", 14}, {"R15", 15},
+    {"SCREEN", 16384}, {"KBD", 24576}
+};
+
+inline constexpr size_t PREDEFINED_COUNT = sizeof(PREDEFINED_SYMBOLS) / sizeof(PREDEFINED_SYMBOLS[0]);
+
+// FNV-1a 32 位哈希，可在编译期求值
+constexpr uint32_t hashSymbol(std::string_view symbol) {
+    uint32_t hash = 2166136261u;
+    for (char c : symbol) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 预定义符号的哈希值，编译期计算
+constexpr std::array<uint32_t, PREDEFINED_COUNT> buildPredefinedHashes() {
+    std::array<uint32_t, PREDEFINED_COUNT> hashes{};
+    for (size_t id = 0; id < PREDEFINED_COUNT; id++) {
+        hashes[id] = hashSymbol(PREDEFINED_SYMBOLS[id].name);
+    }
+    return hashes;
+}
+
+inline constexpr std::array<uint32_t, PREDEFINED_COUNT> PREDEFINED_HASHES = buildPredefinedHashes();
+
+// 符号表初始容量：2 的幂，预定义符号的负载因子 < 0.5
+inline constexpr size_t SYMBOL_TABLE_INITIAL_CAPACITY = 64;
+inline constexpr uint32_t SYMBOL_TABLE_EMPTY = 0xFFFFFFFFu;
+
+// 编译期生成预定义符号的初始槽位（线性探测），槽中存放 PREDEFINED_SYMBOLS 的下标
+constexpr std::array<uint32_t, SYMBOL_TABLE_INITIAL_CAPACITY> buildPredefinedSlots() {
+    std::array<uint32_t, SYMBOL_TABLE_INITIAL_CAPACITY> slots{};
+    for (size_t i = 0; i < SYMBOL_TABLE_INITIAL_CAPACITY; i++) {
+        slots[i] = SYMBOL_TABLE_EMPTY;
+    }
+    for (size_t id = 0; id < PREDEFINED_COUNT; id++) {
+        size_t slot = PREDEFINED_HASHES[id] & (SYMBOL_TABLE_INITIAL_CAPACITY - 1);
+        while (slots[slot] != SYMBOL_TABLE_EMPTY) {
+            slot = (slot + 1) & (SYMBOL_TABLE_INITIAL_CAPACITY - 1);
+        }
+        slots[slot] = static_cast<uint32_t>(id);
+    }
+    return slots;
+}
+
+inline constexpr std::array<uint32_t, SYMBOL_TABLE_INITIAL_CAPACITY> PREDEFINED_SLOTS = buildPredefinedSlots();
+
+// 符号名的字符串池：按块分配，符号名只在第一次出现时复制一次，
+// 之后整个汇编过程中都通过 string_view 引用，块不会移动
+class StringArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+
+public:
+    std::string_view store(std::string_view str) {
+        if (str.size() > remaining) {
+            size_t size = (str.size() > BLOCK_SIZE) ? str.size() : BLOCK_SIZE;
+            blocks.emplace_back(new char[size]);
+            cursor = blocks.back().get();
+            remaining = size;
+        }
+        std::memcpy(cursor, str.data(), str.size());
+        std::string_view stored(cursor, str.size());
+        cursor += str.size();
+        remaining -= str.size();
+        return stored;
+    }
+};
+
+// 符号表：驻留（intern）的符号名 + 开放寻址（线性探测）哈希表。
+// 每个符号对应一个稳定的 id，intern() 一次哈希完成"查找或插入"；
+// 预定义符号的哈希值和初始槽位都在编译期生成，构造时直接复制，不再逐个插入。
 class SymbolTable {
+public:
+    static constexpr int UNRESOLVED = -1;
+
 private:
-    std::unordered_map<std::string, int> table;
+    struct Entry {
+        std::string_view name;
+        uint32_t hash;
+        int address;
+    };
+
+    std::vector<Entry> entries;  // 按 id 存放
+    std::vector<uint32_t> slots; // 开放寻址表，存放 id
+    size_t mask;
+    StringArena arena;
+
+    void grow() {
+        std::vector<uint32_t> newSlots(slots.size() * 2, SYMBOL_TABLE_EMPTY);
+        size_t newMask = newSlots.size() - 1;
+        for (uint32_t id = 0; id < entries.size(); id++) {
+            size_t slot = entries[id].hash & newMask;
+            while (newSlots[slot] != SYMBOL_TABLE_EMPTY) {
+                slot = (slot + 1) & newMask;
+            }
+            newSlots[slot] = id;
+        }
+        slots.swap(newSlots);
+        mask = newMask;
+    }
 
 public:
-    SymbolTable() {
-        // 预定义符号
-        table["SP"] = 0;
-        table["LCL"] = 1;
-        table["ARG"] = 2;
-        table["THIS"] = 3;
-        table["THAT"] = 4;
-        table["R0"] = 0;
-        table["R1"] = 1;
-        table["R2"] = 2;
-        table["R3"] = 3;
-        table["R4"] = 4;
-        table["R5"] = 5;
-        table["R6"] = 6;
-        table["R7"] = 7;
-        table["R8"] = 8;
-        table["R9"] = 9;
-        table["R10"] = 10;
-        table["R11"] = 11;
-        table["R12"] = 12;
-        table["R13"] = 13;
-        table["R14"] = 14;
-        table["R15"] = 15;
-        table["SCREEN"] = 16384;
-        table["KBD"] = 24576;
-    }
-
-    void addEntry(const std::string& symbol, int address) {
-        table[symbol] = address;
-    }
-
-    bool contains(const std::string& symbol) const {
-        return table.find(symbol) != table.end();
-    }
-
-    int getAddress(const std::string& symbol) const {
-        return table.at(symbol);
+    SymbolTable()
+        : slots(PREDEFINED_SLOTS.begin(), PREDEFINED_SLOTS.end()),
+          mask(SYMBOL_TABLE_INITIAL_CAPACITY - 1) {
+        entries.reserve(SYMBOL_TABLE_INITIAL_CAPACITY / 2);
+        for (size_t id = 0; id < PREDEFINED_COUNT; id++) {
+            entries.push_back({PREDEFINED_SYMBOLS[id].name, PREDEFINED_HASHES[id],
+                               PREDEFINED_SYMBOLS[id].address});
+        }
+    }
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // 只读查找，不插入；找不到返回 UNRESOLVED。多个线程可同时调用
+    int find(std::string_view symbol) const {
+        uint32_t hash = hashSymbol(symbol);
+        size_t slot = hash & mask;
+        while (slots[slot] != SYMBOL_TABLE_EMPTY) {
+            const Entry& entry = entries[slots[slot]];
+            if (entry.hash == hash && entry.name == symbol) {
+                return entry.address;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return UNRESOLVED;
+    }
+
+    // 查找或插入：返回符号的 id，新符号的地址为 UNRESOLVED
+    uint32_t intern(std::string_view symbol) {
+        uint32_t hash = hashSymbol(symbol);
+        size_t slot = hash & mask;
+        while (slots[slot] != SYMBOL_TABLE_EMPTY) {
+            const Entry& entry = entries[slots[slot]];
+            if (entry.hash == hash && entry.name == symbol) {
+                return slots[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        uint32_t id = static_cast<uint32_t>(entries.size());
+        entries.push_back({arena.store(symbol), hash, UNRESOLVED});
+        slots[slot] = id;
+        // 负载因子保持在 1/2 以下
+        if (entries.size() * 2 > slots.size()) {
+            grow();
+        }
+        return id;
+    }
+
+    // 预定义符号占据最前面的 id
+    static bool isPredefined(uint32_t id) {
+        return id < PREDEFINED_COUNT;
+    }
+
+    int& address(uint32_t id) {
+        return entries[id].address;
+    }
+
+    int address(uint32_t id) const {
+        return entries[id].address;
+    }
+
+    std::string_view name(uint32_t id) const {
+        return entries[id].name;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    void addEntry(std::string_view symbol, int address) {
+        entries[intern(symbol)].address = address;
+    }
+
+    // 查找或插入：返回地址槽的引用，新符号的地址为 UNRESOLVED
+    int& lookupOrInsert(std::string_view symbol) {
+        return entries[intern(symbol)].address;
     }
 };
 
@@ -1,40 +1,234 @@
 // cd "project/06 - Assembler/code/cpp"
 // make                          # 编译
 // ./assembler ../test/Add.asm   # 汇编单个文件
+// ./assembler --two-pass ../test/Add.asm     # 教材中的两遍扫描实现
+// ./assembler --format=bin ../test/Pong.asm   # 输出小端 16 位 ROM 镜像 (.bin)
+// ./assembler --parallel=4 ../test/Pong.asm   # 多线程汇编（省略线程数则按核心数）
+// ./assembler ../test                         # 批量汇编目录或多个文件（线程池）
+// ./assembler --compress Prog.asm             # 抽取重复指令序列为子程序，减小 ROM 占用
+// ./assembler --object Math.asm Main.asm      # 汇编成可重定位目标文件 Math.hobj、Main.hobj
+// ./assembler --link --output=Prog.hack Main.hobj Math.hobj   # 链接目标文件
+// ./assembler --cache=/tmp/asm-cache Prog.asm # 使用构建缓存（也可设置环境变量 HACK_ASM_CACHE）
+// ./assembler --cache-stats                   # 查看缓存命中统计
+// ./VMTranslator ... | ./assembler - | ...     # "-" 表示标准输入 / 标准输出，流式汇编
+// ./assembler --map Prog.asm                   # 同时生成 Prog.hmap：ROM 地址 -> 源码行、标签、VM 命令
+// ./assembler --dump-map Prog.hmap            # 以文本形式查看调试映射
+// ./assembler --stats Prog.asm                # 指令构成、ROM/RAM 占用和最大的标签区域
 // make test                     # 汇编所有测试文件
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <bitset>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "Parser.h"
 #include "Code.h"
 #include "SymbolTable.h"
+#include "MappedFile.h"
+#include "HackAssembler.h"
+#include "ThreadPool.h"
+#include "BuildCache.h"
+#include "StreamingAssembler.h"
+#include "DebugMap.h"
+#include "AsmStats.h"
 
-std::string decimalToBinary(int decimal) {
-    return std::bitset<16>(decimal).to_string();
+// 默认模式：内存映射源文件交给汇编库（单遍或多线程），有错误时输出诊断信息
+bool assembleMapped(const std::string& inputFile, const AssembleOptions& options,
+                    std::vector<uint16_t>& words) {
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+
+    Diagnostics diagnostics;
+    words = assemble(source.view(), diagnostics, options);
+    diagnostics.print(std::cerr, inputFile);
+    return !diagnostics.hasErrors();
 }
 
-bool isNumber(const std::string& str) {
-    if (str.empty()) return false;
-    for (char c : str) {
-        if (!std::isdigit(c)) return false;
+// 压缩模式：汇编后抽取重复序列，报告节省的 ROM 和增加的周期
+bool assembleCompressedFile(const std::string& inputFile, std::vector<uint16_t>& words) {
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+
+    Diagnostics diagnostics;
+    CompressionReport report;
+    words = assembleCompressed(source.view(), diagnostics, report);
+    diagnostics.print(std::cerr, inputFile);
+
+    if (report.applied) {
+        size_t saved = report.originalSize - report.compressedSize;
+        std::cout << "代码压缩: " << report.originalSize << " -> " << report.compressedSize
+                  << " 条指令，节省 " << saved << " 条 ("
+                  << saved * 100.0 / report.originalSize << "%)" << std::endl;
+        std::cout << "  抽取 " << report.subroutines << " 个子程序，替换 " << report.callSites
+                  << " 处；每处每执行一次多 " << CompressionReport::CYCLES_PER_CALL
+                  << " 个周期，返回地址存放在 RAM[" << report.returnRegister << "]" << std::endl;
+    } else if (!report.reason.empty()) {
+        std::cout << "未压缩: " << report.reason << std::endl;
+    }
+    return !diagnostics.hasErrors();
+}
+
+// 流式模式：输入或输出为 "-" 时使用标准输入 / 标准输出，边读边写，不生成临时文件。
+// 标准输出被机器码占用，提示信息一律写到标准错误
+int assembleStreaming(const std::string& inputFile, const std::string& outputFile, OutputFormat format) {
+    int input = 0;
+    if (inputFile != "-") {
+        input = open(inputFile.c_str(), O_RDONLY);
+        if (input < 0) {
+            std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+            return 1;
+        }
+    }
+    int output = 1;
+    if (outputFile != "-") {
+        output = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (output < 0) {
+            std::cerr << "无法创建输出文件: " << outputFile << std::endl;
+            if (input != 0) close(input);
+            return 1;
+        }
     }
+
+    Diagnostics diagnostics;
+    StreamingAssembler assembler(output, format);
+    bool ok = assembler.assemble(input, diagnostics);
+    if (input != 0) close(input);
+    if (output != 1) ok &= (close(output) == 0);
+
+    diagnostics.print(std::cerr, inputFile == "-" ? "<stdin>" : inputFile);
+    if (!ok) {
+        std::cerr << "读写失败" << std::endl;
+        return 1;
+    }
+    return diagnostics.hasErrors() ? 1 : 0;
+}
+
+// 调试映射：扫描源码生成 .hmap，与输出文件放在一起
+bool writeDebugMap(const std::string& inputFile, const std::string& mapFile) {
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+    std::string data = DebugMap::build(source.view()).serialize();
+    if (!HackWriter::writeAll(mapFile, data.data(), data.size())) {
+        std::cerr << "无法创建调试映射: " << mapFile << std::endl;
+        return false;
+    }
+    std::cout << "调试映射: " << mapFile << std::endl;
     return true;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "用法: " << argv[0] << " <input.asm>" << std::endl;
+// 统计报告：即使程序超出 ROM 也照样输出，方便找出膨胀的来源
+bool printStatistics(const std::string& inputFile) {
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+    std::cout << "统计: " << inputFile << std::endl;
+    AsmStatistics::collect(source.view()).print(std::cout);
+    return true;
+}
+
+// 以 "地址 行号 标签 VM 命令 Jack 源码" 的制表符分隔文本输出 .hmap
+int dumpDebugMap(const std::string& mapFile) {
+    MappedFile file(mapFile);
+    if (!file.isOpen()) {
+        std::cerr << "无法打开调试映射: " << mapFile << std::endl;
+        return 1;
+    }
+    DebugMap map;
+    std::string error;
+    if (!DebugMap::parse(file.view(), map, error)) {
+        std::cerr << mapFile << ": 错误: " << error << std::endl;
+        return 1;
+    }
+    auto text = [](const std::string* value) { return value != nullptr ? *value : std::string("-"); };
+    std::string out;
+    for (uint32_t address = 0; address < map.lines.size(); address++) {
+        out += std::to_string(address) + "\t" + std::to_string(map.lines[address]) + "\t" +
+               text(map.label(address)) + "\t" + text(map.vmCommand(address)) + "\t" +
+               text(map.jackSource(address)) + "\n";
+    }
+    std::cout << out;
+    return 0;
+}
+
+// 目标文件模式：汇编成 .hobj，留给链接器
+bool assembleObjectFile(const std::string& inputFile, const std::string& outputFile, size_t& wordCount) {
+    MappedFile source(inputFile);
+    if (!source.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return false;
+    }
+
+    Diagnostics diagnostics;
+    HackObject object = assembleObject(source.view(), diagnostics);
+    diagnostics.print(std::cerr, inputFile);
+    if (diagnostics.hasErrors()) {
+        return false;
+    }
+
+    wordCount = object.words.size();
+    std::string data = object.serialize();
+    if (!HackWriter::writeAll(outputFile, data.data(), data.size())) {
+        std::cerr << "无法创建输出文件: " << outputFile << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 链接模式：按命令行顺序读入 .hobj，链接成最终程序
+int linkObjects(const std::vector<std::string>& inputs, const std::string& outputFile, OutputFormat format) {
+    auto start = std::chrono::steady_clock::now();
+    Linker linker;
+    for (const std::string& input : inputs) {
+        MappedFile file(input);
+        if (!file.isOpen()) {
+            std::cerr << "无法打开目标文件: " << input << std::endl;
+            return 1;
+        }
+        HackObject object;
+        std::string error;
+        if (!HackObject::parse(file.view(), object, error)) {
+            std::cerr << input << ": 错误: " << error << std::endl;
+            return 1;
+        }
+        linker.add(input, std::move(object));
+    }
+
+    Diagnostics diagnostics;
+    std::vector<uint16_t> words = linker.link(diagnostics);
+    diagnostics.print(std::cerr, outputFile);
+    if (diagnostics.hasErrors()) {
+        return 1;
+    }
+    if (!HackWriter::write(outputFile, words, format)) {
+        std::cerr << "无法创建输出文件: " << outputFile << std::endl;
         return 1;
     }
 
-    std::string inputFile = argv[1];
-    std::string outputFile = inputFile.substr(0, inputFile.find_last_of('.')) + ".hack";
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "链接成功！输出文件: " << outputFile << " (" << linker.moduleCount() << " 个模块，"
+              << words.size() << " 条指令，用时 " << ms << " ms)" << std::endl;
+    return 0;
+}
 
+// 两遍模式：第一遍收集标签，第二遍生成机器码
+std::vector<uint16_t> assembleTwoPass(const std::string& inputFile) {
     // 初始化符号表
     SymbolTable symbolTable;
-    Code code;
 
     // 第一次遍历：构建符号表（处理标签）
     Parser firstPass(inputFile);
@@ -62,15 +256,8 @@ int main(int argc, char* argv[]) {
 
     // 第二次遍历：生成机器码
     Parser secondPass(inputFile);
-    std::ofstream outFile(outputFile);
-
-    if (!outFile.is_open()) {
-        std::cerr << "无法创建输出文件: " << outputFile << std::endl;
-        return 1;
-    }
-
+    std::vector<uint16_t> words;
     int nextVariableAddress = 16; // 变量从 RAM[16] 开始分配
-    bool firstLine = true;
 
     while (secondPass.hasMoreCommands()) {
         secondPass.advance();
@@ -89,39 +276,469 @@ int main(int argc, char* argv[]) {
             if (isNumber(symbol)) {
                 // 直接是数字
                 address = std::stoi(symbol);
-            } else if (symbolTable.contains(symbol)) {
-                // 已知符号（预定义或标签）
-                address = symbolTable.getAddress(symbol);
             } else {
-                // 新变量
-                symbolTable.addEntry(symbol, nextVariableAddress);
-                address = nextVariableAddress;
-                nextVariableAddress++;
+                // 一次查找：已知符号（预定义或标签）直接取地址，新符号分配为变量
+                int& entry = symbolTable.lookupOrInsert(symbol);
+                if (entry == SymbolTable::UNRESOLVED) {
+                    entry = nextVariableAddress++;
+                }
+                address = entry;
             }
 
-            if (!firstLine) outFile << "\n";
-            outFile << decimalToBinary(address);
-            firstLine = false;
+            words.push_back(static_cast<uint16_t>(address));
 
         } else if (type == C_COMMAND) {
             std::string destStr = secondPass.dest();
             std::string compStr = secondPass.comp();
             std::string jumpStr = secondPass.jump();
 
-            std::string binaryCode = "111" + 
-                                    code.comp(compStr) + 
-                                    code.dest(destStr) + 
-                                    code.jump(jumpStr);
+            uint16_t instruction = Code::C_PREFIX |
+                                   Code::comp(compStr) |
+                                   Code::dest(destStr) |
+                                   Code::jump(jumpStr);
 
-            if (!firstLine) outFile << "\n";
-            outFile << binaryCode;
-            firstLine = false;
+            words.push_back(instruction);
         }
         // L_COMMAND 不生成代码
     }
 
-    outFile.close();
+    return words;
+}
+
+// 检查路径是否是目录
+bool isDirectory(const std::string& path) {
+    struct stat statbuf;
+    if (stat(path.c_str(), &statbuf) != 0) {
+        return false;
+    }
+    return S_ISDIR(statbuf.st_mode);
+}
+
+// 获取目录中所有的 .asm 文件（按文件名排序，保证输出顺序稳定）
+std::vector<std::string> getAsmFiles(const std::string& dirPath) {
+    std::vector<std::string> asmFiles;
+    DIR* dir = opendir(dirPath.c_str());
+    if (dir == nullptr) {
+        return asmFiles;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string filename = entry->d_name;
+        if (filename.length() > 4 && filename.substr(filename.length() - 4) == ".asm") {
+            asmFiles.push_back(dirPath + "/" + filename);
+        }
+    }
+    closedir(dir);
+    std::sort(asmFiles.begin(), asmFiles.end());
+    return asmFiles;
+}
+
+// 把路径最后一段的扩展名换成 extension，没有扩展名时直接追加（目录名中的 '.' 不算）
+std::string replaceExtension(const std::string& path, const std::string& extension) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + extension;
+    }
+    return path.substr(0, dot) + extension;
+}
+
+std::string outputPath(const std::string& inputFile, OutputFormat format, bool object = false) {
+    return inputFile.substr(0, inputFile.find_last_of('.')) + (object ? ".hobj" : HackWriter::extension(format));
+}
+
+// 批量模式中单个文件的汇编结果
+struct BatchResult {
+    std::string inputFile;
+    std::string outputFile;
+    std::string error; // 为空表示成功
+    Diagnostics diagnostics;
+    size_t bytes = 0;
+    size_t lines = 0;
+    size_t words = 0;
+    size_t uncompressedWords = 0; // --compress 实际压缩时为压缩前的指令数，否则为 0
+    bool cached = false;
+};
+
+// 缓存键中的输出变体：同一源码的不同输出格式、是否压缩分别缓存
+std::string cacheVariant(OutputFormat format, bool compress) {
+    return HackWriter::extension(format) + (compress ? "+compress" : "");
+}
+
+void assembleBatchFile(BatchResult& result, OutputFormat format, bool object, bool compress, BuildCache* cache) {
+    MappedFile source(result.inputFile);
+    if (!source.isOpen()) {
+        result.error = "无法打开输入文件";
+        return;
+    }
+
+    std::string_view text = source.view();
+    result.bytes = text.size();
+    result.lines = std::count(text.begin(), text.end(), '\n');
+
+    uint64_t key = 0;
+    std::string extension = HackWriter::extension(format);
+    if (cache != nullptr && !object) {
+        key = BuildCache::key(text, cacheVariant(format, compress));
+        if (cache->fetch(key, extension, result.outputFile)) {
+            result.cached = true;
+            return;
+        }
+    }
+
+    bool written;
+    if (object) {
+        HackObject hobj = assembleObject(text, result.diagnostics);
+        result.words = hobj.words.size();
+        if (result.diagnostics.hasErrors()) {
+            result.error = std::to_string(result.diagnostics.errorCount()) + " 个错误";
+            return;
+        }
+        std::string data = hobj.serialize();
+        written = HackWriter::writeAll(result.outputFile, data.data(), data.size());
+    } else {
+        std::vector<uint16_t> words;
+        if (compress) {
+            CompressionReport report;
+            words = assembleCompressed(text, result.diagnostics, report);
+            if (report.applied) result.uncompressedWords = report.originalSize;
+        } else {
+            words = assemble(text, result.diagnostics);
+        }
+        result.words = words.size();
+        if (result.diagnostics.hasErrors()) {
+            result.error = std::to_string(result.diagnostics.errorCount()) + " 个错误";
+            return;
+        }
+        written = HackWriter::write(result.outputFile, words, format);
+    }
+
+    if (!written) {
+        result.error = "无法创建输出文件 " + result.outputFile;
+    } else if (cache != nullptr && !object) {
+        cache->store(key, extension, result.outputFile);
+    }
+}
+
+// 批量模式的线程数上限：每个文件的汇编只需几毫秒，更多线程只增加创建开销
+constexpr size_t MAX_JOBS = 64;
+
+// 批量模式：所有文件投递到线程池，每个文件用单遍汇编库，逐个报告结果并给出总吞吐量
+int assembleBatch(const std::vector<std::string>& inputs, OutputFormat format, unsigned jobs, bool object,
+                  bool compress, BuildCache* cache) {
+    std::vector<BatchResult> results;
+    for (const std::string& input : inputs) {
+        if (isDirectory(input)) {
+            std::vector<std::string> asmFiles = getAsmFiles(input);
+            if (asmFiles.empty()) {
+                std::cerr << "警告: 目录中没有找到 .asm 文件: " << input << std::endl;
+            }
+            for (const std::string& asmFile : asmFiles) {
+                results.emplace_back();
+                results.back().inputFile = asmFile;
+            }
+        } else {
+            results.emplace_back();
+            results.back().inputFile = input;
+        }
+    }
+    if (results.empty()) {
+        std::cerr << "错误: 没有需要汇编的 .asm 文件" << std::endl;
+        return 1;
+    }
+
+    // 线程数不超过文件数和 MAX_JOBS：多出的线程没有任务可做，数量过大时还会创建失败
+    unsigned workers = jobs != 0 ? jobs : std::thread::hardware_concurrency();
+    workers = static_cast<unsigned>(std::min<size_t>({std::max(workers, 1u), results.size(), MAX_JOBS}));
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(workers);
+        for (BatchResult& result : results) {
+            result.outputFile = outputPath(result.inputFile, format, object);
+            pool.submit([&result, format, object, compress, cache]() {
+                assembleBatchFile(result, format, object, compress, cache);
+            });
+        }
+        pool.wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    size_t totalBytes = 0;
+    size_t totalLines = 0;
+    size_t totalWords = 0;
+    for (const BatchResult& result : results) {
+        result.diagnostics.print(std::cerr, result.inputFile);
+        if (!result.error.empty()) {
+            std::cerr << "失败: " << result.inputFile << ": " << result.error << std::endl;
+            failed++;
+            continue;
+        }
+        if (result.cached) {
+            std::cout << "缓存命中: " << result.inputFile << " -> " << result.outputFile << std::endl;
+        } else {
+            std::cout << "汇编成功: " << result.inputFile << " -> " << result.outputFile
+                      << " (" << result.words << " 条指令";
+            if (result.uncompressedWords != 0) {
+                std::cout << "，压缩前 " << result.uncompressedWords;
+            }
+            std::cout << ")" << std::endl;
+        }
+        totalBytes += result.bytes;
+        totalLines += result.lines;
+        totalWords += result.words;
+    }
+
+    if (seconds <= 0) seconds = 1e-9;
+    std::cout << "共 " << results.size() << " 个文件，成功 " << (results.size() - failed)
+              << "，失败 " << failed << "；" << totalLines << " 行，" << totalWords << " 条指令，用时 "
+              << seconds * 1000 << " ms（" << static_cast<size_t>(totalLines / seconds) << " 行/秒，"
+              << totalBytes / seconds / (1024 * 1024) << " MB/秒）" << std::endl;
+    if (cache != nullptr) {
+        BuildCache::Stats stats = cache->sessionStats();
+        std::cout << "缓存: 命中 " << stats.hits << "，未命中 " << stats.misses << std::endl;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
+
+// 输出缓存目录的累计统计
+void printCacheStats(const BuildCache& cache) {
+    BuildCache::Stats stats = cache.totalStats();
+    size_t entries = 0;
+    uint64_t bytes = 0;
+    cache.usage(entries, bytes);
+    uint64_t lookups = stats.hits + stats.misses;
+    std::cout << "缓存目录: " << cache.path() << std::endl;
+    std::cout << "  缓存项: " << entries << " 个，" << bytes / 1024.0 << " KB" << std::endl;
+    std::cout << "  命中 " << stats.hits << "，未命中 " << stats.misses << "，命中率 "
+              << (lookups > 0 ? stats.hits * 100.0 / lookups : 0.0) << "%；写入 " << stats.stores
+              << "，淘汰 " << stats.evictions << std::endl;
+}
+
+// 选项 arg 在前缀 prefix 个字符之后是否为 1-9 位十进制数（更长的数 stoul 会溢出，也没有意义）
+bool isCount(const std::string& arg, size_t prefix) {
+    return arg.size() > prefix && arg.size() - prefix <= 9 &&
+           arg.find_first_not_of("0123456789", prefix) == std::string::npos;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "用法: " << program << " [--two-pass | --single-pass | --parallel[=N]] [--compress] [--format=hack|bin] <input.asm>" << std::endl;
+    std::cerr << "      " << program << " [--jobs=N] [--object] [--format=hack|bin] <input.asm | directory>..." << std::endl;
+    std::cerr << "      " << program << " --link [--output=out.hack] [--format=hack|bin] <input.hobj>..." << std::endl;
+    std::cerr << "      " << program << " [--map] [--stats] <input.asm> | --dump-map <input.hmap>" << std::endl;
+    std::cerr << "      缓存选项: --cache[=DIR] --cache-max=MB --cache-stats --no-cache" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool twoPass = false;
+    bool compress = false;
+    bool object = false;
+    bool link = false;
+    bool debugMap = false;
+    bool stats = false;
+    std::string outputFile;
+    // 构建缓存默认关闭，用 --cache 或环境变量 HACK_ASM_CACHE（缓存目录）开启
+    const char* cacheEnv = std::getenv("HACK_ASM_CACHE");
+    bool useCache = (cacheEnv != nullptr && *cacheEnv != '\0');
+    bool cacheStats = false;
+    std::string cacheDirectory = useCache ? cacheEnv : "";
+    uint64_t cacheMaxBytes = BuildCache::DEFAULT_MAX_BYTES;
+    AssembleOptions options;
+    unsigned jobs = 0;    // 批量模式的线程池大小，0 表示按核心数
+    OutputFormat format = OutputFormat::TEXT;
+    std::vector<std::string> inputs;
+    bool usageError = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--two-pass") {
+            twoPass = true;
+        } else if (arg == "--compress") {
+            compress = true;
+        } else if (arg == "--cache") {
+            useCache = true;
+        } else if (arg.compare(0, 8, "--cache=") == 0) {
+            useCache = true;
+            cacheDirectory = arg.substr(8);
+        } else if (arg.compare(0, 12, "--cache-max=") == 0 && isCount(arg, 12)) {
+            cacheMaxBytes = std::stoull(arg.substr(12)) * 1024 * 1024;
+        } else if (arg == "--cache-stats") {
+            cacheStats = true;
+        } else if (arg == "--no-cache") {
+            useCache = false;
+        } else if (arg == "--object") {
+            object = true;
+        } else if (arg == "--link") {
+            link = true;
+        } else if (arg == "--map") {
+            debugMap = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg.compare(0, 11, "--dump-map=") == 0) {
+            return dumpDebugMap(arg.substr(11));
+        } else if (arg == "--dump-map" && i + 1 < argc) {
+            return dumpDebugMap(argv[i + 1]);
+        } else if (arg.compare(0, 9, "--output=") == 0) {
+            outputFile = arg.substr(9);
+        } else if (arg == "--single-pass") {
+            options.parallel = false;
+        } else if (arg == "--parallel") {
+            options.parallel = true;
+        } else if (arg.compare(0, 11, "--parallel=") == 0 && isCount(arg, 11)) {
+            options.parallel = true;
+            options.threads = static_cast<unsigned>(std::stoul(arg.substr(11)));
+        } else if (arg.compare(0, 7, "--jobs=") == 0 && isCount(arg, 7)) {
+            jobs = static_cast<unsigned>(std::stoul(arg.substr(7)));
+        } else if (arg == "--format=bin") {
+            format = OutputFormat::BINARY;
+        } else if (arg == "--format=hack") {
+            format = OutputFormat::TEXT;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << (arg == "--dump-map" ? "缺少调试映射文件: " : "无效的选项: ") << arg << std::endl;
+            usageError = true;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (usageError) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<BuildCache> cache;
+    if (useCache || cacheStats) {
+        if (cacheDirectory.empty()) {
+            const char* home = std::getenv("HOME");
+            cacheDirectory = std::string(home != nullptr ? home : ".") + "/.cache/hack-assembler";
+        }
+        cache.reset(new BuildCache(cacheDirectory, cacheMaxBytes));
+        if (useCache && !cache->create()) {
+            std::cerr << "警告: 无法创建缓存目录 " << cacheDirectory << "，不使用缓存" << std::endl;
+            useCache = false;
+        }
+    }
+    if (cacheStats && inputs.empty()) {
+        printCacheStats(*cache);
+        return 0;
+    }
+    BuildCache* activeCache = useCache ? cache.get() : nullptr;
+
+    if (inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (link) {
+        if (outputFile.empty()) {
+            outputFile = outputPath(inputs[0], format);
+        }
+        return linkObjects(inputs, outputFile, format);
+    }
+
+    // 多个输入或目录：批量模式
+    if (inputs.size() > 1 || isDirectory(inputs[0])) {
+        if (debugMap || stats) {
+            std::cerr << "警告: 批量模式不生成调试映射和统计，忽略 --map/--stats" << std::endl;
+        }
+        // 文件之间已经并行，每个文件都用单遍汇编器；--compress 照常生效（--object 时除外，与单文件模式一致）
+        if (twoPass || options.parallel) {
+            std::cerr << "警告: 批量模式每个文件使用单遍汇编，忽略 --two-pass/--parallel" << std::endl;
+        }
+        if (compress && object) {
+            std::cerr << "警告: 目标文件不做代码压缩，忽略 --compress" << std::endl;
+        }
+        int status = assembleBatch(inputs, format, jobs, object, compress, activeCache);
+        if (activeCache != nullptr) activeCache->finish();
+        if (cacheStats) printCacheStats(*cache);
+        return status;
+    }
+
+    std::string inputFile = inputs[0];
+    if (outputFile.empty()) {
+        outputFile = (inputFile == "-") ? "-" : outputPath(inputFile, format, object);
+    }
+
+    if (inputFile == "-" || outputFile == "-") {
+        if (twoPass || compress || object || options.parallel || debugMap || stats) {
+            std::cerr << "警告: 流式模式只做单遍汇编，忽略 --two-pass/--compress/--object/--parallel/--map/--stats"
+                      << std::endl;
+        }
+        return assembleStreaming(inputFile, outputFile, format);
+    }
+
+    if (stats && !printStatistics(inputFile)) {
+        return 1;
+    }
+
+    // 两遍汇编器不做代码压缩。在计算缓存键之前清除，否则未压缩的输出会存进 +compress 的缓存项
+    if (twoPass && compress) {
+        std::cerr << "警告: --two-pass 不做代码压缩，忽略 --compress" << std::endl;
+        compress = false;
+    }
+
+    // 代码压缩会移动指令，源码中的地址不再对应 ROM 地址
+    if (debugMap && (compress || object)) {
+        std::cerr << "警告: --compress / --object 的输出地址与源码不对应，忽略 --map" << std::endl;
+        debugMap = false;
+    }
+    // .hmap 与输出文件同名同目录（--output=out/t.hack 时为 out/t.hmap）；
+    // 输出为 "-" 时已经走了上面的流式模式，那里忽略 --map
+    std::string mapFile = replaceExtension(outputFile, ".hmap");
+
+    if (object) {
+        size_t wordCount = 0;
+        if (!assembleObjectFile(inputFile, outputFile, wordCount)) {
+            return 1;
+        }
+        std::cout << "汇编成功！目标文件: " << outputFile << " (" << wordCount << " 条指令)" << std::endl;
+        return 0;
+    }
+
+    // 缓存命中时不解析源码，直接复制缓存的输出
+    uint64_t key = 0;
+    std::string extension = HackWriter::extension(format);
+    if (activeCache != nullptr) {
+        MappedFile source(inputFile);
+        if (source.isOpen()) {
+            key = BuildCache::key(source.view(), cacheVariant(format, compress));
+            if (activeCache->fetch(key, extension, outputFile)) {
+                activeCache->finish();
+                std::cout << "汇编成功（缓存命中）！输出文件: " << outputFile << std::endl;
+                if (debugMap && !writeDebugMap(inputFile, mapFile)) return 1;
+                if (cacheStats) printCacheStats(*cache);
+                return 0;
+            }
+        }
+    }
+
+    std::vector<uint16_t> words;
+    if (twoPass) {
+        words = assembleTwoPass(inputFile);
+    } else if (compress) {
+        if (!assembleCompressedFile(inputFile, words)) {
+            return 1;
+        }
+    } else if (!assembleMapped(inputFile, options, words)) {
+        return 1;
+    }
+
+    if (!HackWriter::write(outputFile, words, format)) {
+        std::cerr << "无法创建输出文件: " << outputFile << std::endl;
+        return 1;
+    }
+
     std::cout << "汇编成功！输出文件: " << outputFile << std::endl;
+    if (debugMap && !writeDebugMap(inputFile, mapFile)) {
+        return 1;
+    }
+    if (activeCache != nullptr) {
+        activeCache->store(key, extension, outputFile);
+        activeCache->finish();
+    }
+    if (cacheStats) printCacheStats(*cache);
 
     return 0;
 }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <fstream>
+#include "Parser.h"
 
 class CodeWriter {
 private:
@@ -47,30 +48,41 @@ public:
         }
     }
 
+    // 段基址指针：local/argument/this/that 对应 LCL/ARG/THIS/THAT，其余段为空
+    static const char* segmentPointer(Segment segment) {
+        switch (segment) {
+            case Segment::LOCAL:    return "LCL";
+            case Segment::ARGUMENT: return "ARG";
+            case Segment::THIS:     return "THIS";
+            case Segment::THAT:     return "THAT";
+            default:                return nullptr;
+        }
+    }
+
     // 写入算术/逻辑命令
-    void writeArithmetic(const std::string& command) {
-        writeComment(command);
+    void writeArithmetic(Opcode command) {
+        writeComment(opcodeName(command));
 
-        if (command == "add") {
+        if (command == Opcode::ADD) {
             outFile << "@SP" << std::endl;
             outFile << "AM=M-1" << std::endl;
             outFile << "D=M" << std::endl;
             outFile << "A=A-1" << std::endl;
             outFile << "M=D+M" << std::endl;
         }
-        else if (command == "sub") {
+        else if (command == Opcode::SUB) {
             outFile << "@SP" << std::endl;
             outFile << "AM=M-1" << std::endl;
             outFile << "D=M" << std::endl;
             outFile << "A=A-1" << std::endl;
             outFile << "M=M-D" << std::endl;
         }
-        else if (command == "neg") {
+        else if (command == Opcode::NEG) {
             outFile << "@SP" << std::endl;
             outFile << "A=M-1" << std::endl;
             outFile << "M=-M" << std::endl;
         }
-        else if (command == "eq") {
+        else if (command == Opcode::EQ) {
             std::string trueLabel = getUniqueLabel("EQ_TRUE");
             std::string endLabel = getUniqueLabel("EQ_END");
             
@@ -92,7 +104,7 @@ public:
             outFile << "M=-1" << std::endl;
             outFile << "(" << endLabel << ")" << std::endl;
         }
-        else if (command == "gt") {
+        else if (command == Opcode::GT) {
             std::string trueLabel = getUniqueLabel("GT_TRUE");
             std::string endLabel = getUniqueLabel("GT_END");
             
@@ -114,7 +126,7 @@ public:
             outFile << "M=-1" << std::endl;
             outFile << "(" << endLabel << ")" << std::endl;
         }
-        else if (command == "lt") {
+        else if (command == Opcode::LT) {
             std::string trueLabel = getUniqueLabel("LT_TRUE");
             std::string endLabel = getUniqueLabel("LT_END");
             
@@ -136,21 +148,21 @@ public:
             outFile << "M=-1" << std::endl;
             outFile << "(" << endLabel << ")" << std::endl;
         }
-        else if (command == "and") {
+        else if (command == Opcode::AND) {
             outFile << "@SP" << std::endl;
             outFile << "AM=M-1" << std::endl;
             outFile << "D=M" << std::endl;
             outFile << "A=A-1" << std::endl;
             outFile << "M=D&M" << std::endl;
         }
-        else if (command == "or") {
+        else if (command == Opcode::OR) {
             outFile << "@SP" << std::endl;
             outFile << "AM=M-1" << std::endl;
             outFile << "D=M" << std::endl;
             outFile << "A=A-1" << std::endl;
             outFile << "M=D|M" << std::endl;
         }
-        else if (command == "not") {
+        else if (command == Opcode::NOT) {
             outFile << "@SP" << std::endl;
             outFile << "A=M-1" << std::endl;
             outFile << "M=!M" << std::endl;
@@ -158,11 +170,11 @@ public:
     }
 
     // 写入 push/pop 命令
-    void writePushPop(const std::string& command, const std::string& segment, int index) {
-        writeComment(command + " " + segment + " " + std::to_string(index));
+    void writePushPop(Opcode command, Segment segment, int index) {
+        writeComment(std::string(opcodeName(command)) + " " + segmentName(segment) + " " + std::to_string(index));
 
-        if (command == "push") {
-            if (segment == "constant") {
+        if (command == Opcode::PUSH) {
+            if (segment == Segment::CONSTANT) {
                 outFile << "@" << index << std::endl;
                 outFile << "D=A" << std::endl;
                 outFile << "@SP" << std::endl;
@@ -171,15 +183,8 @@ public:
                 outFile << "@SP" << std::endl;
                 outFile << "M=M+1" << std::endl;
             }
-            else if (segment == "local" || segment == "argument" || 
-                     segment == "this" || segment == "that") {
-                std::string segmentPointer;
-                if (segment == "local") segmentPointer = "LCL";
-                else if (segment == "argument") segmentPointer = "ARG";
-                else if (segment == "this") segmentPointer = "THIS";
-                else segmentPointer = "THAT";
-
-                outFile << "@" << segmentPointer << std::endl;
+            else if (segmentPointer(segment) != nullptr) {
+                outFile << "@" << segmentPointer(segment) << std::endl;
                 outFile << "D=M" << std::endl;
                 outFile << "@" << index << std::endl;
                 outFile << "A=D+A" << std::endl;
@@ -190,7 +195,7 @@ public:
                 outFile << "@SP" << std::endl;
                 outFile << "M=M+1" << std::endl;
             }
-            else if (segment == "temp") {
+            else if (segment == Segment::TEMP) {
                 outFile << "@" << (5 + index) << std::endl;
                 outFile << "D=M" << std::endl;
                 outFile << "@SP" << std::endl;
@@ -199,7 +204,7 @@ public:
                 outFile << "@SP" << std::endl;
                 outFile << "M=M+1" << std::endl;
             }
-            else if (segment == "pointer") {
+            else if (segment == Segment::POINTER) {
                 std::string pointer = (index == 0) ? "THIS" : "THAT";
                 outFile << "@" << pointer << std::endl;
                 outFile << "D=M" << std::endl;
@@ -209,7 +214,7 @@ public:
                 outFile << "@SP" << std::endl;
                 outFile << "M=M+1" << std::endl;
             }
-            else if (segment == "static") {
+            else if (segment == Segment::STATIC) {
                 outFile << "@" << currentFileName << "." << index << std::endl;
                 outFile << "D=M" << std::endl;
                 outFile << "@SP" << std::endl;
@@ -219,16 +224,9 @@ public:
                 outFile << "M=M+1" << std::endl;
             }
         }
-        else if (command == "pop") {
-            if (segment == "local" || segment == "argument" || 
-                segment == "this" || segment == "that") {
-                std::string segmentPointer;
-                if (segment == "local") segmentPointer = "LCL";
-                else if (segment == "argument") segmentPointer = "ARG";
-                else if (segment == "this") segmentPointer = "THIS";
-                else segmentPointer = "THAT";
-
-                outFile << "@" << segmentPointer << std::endl;
+        else if (command == Opcode::POP) {
+            if (segmentPointer(segment) != nullptr) {
+                outFile << "@" << segmentPointer(segment) << std::endl;
                 outFile << "D=M" << std::endl;
                 outFile << "@" << index << std::endl;
                 outFile << "D=D+A" << std::endl;
@@ -241,14 +239,14 @@ public:
                 outFile << "A=M" << std::endl;
                 outFile << "M=D" << std::endl;
             }
-            else if (segment == "temp") {
+            else if (segment == Segment::TEMP) {
                 outFile << "@SP" << std::endl;
                 outFile << "AM=M-1" << std::endl;
                 outFile << "D=M" << std::endl;
                 outFile << "@" << (5 + index) << std::endl;
                 outFile << "M=D" << std::endl;
             }
-            else if (segment == "pointer") {
+            else if (segment == Segment::POINTER) {
                 std::string pointer = (index == 0) ? "THIS" : "THAT";
                 outFile << "@SP" << std::endl;
                 outFile << "AM=M-1" << std::endl;
@@ -256,7 +254,7 @@ public:
                 outFile << "@" << pointer << std::endl;
                 outFile << "M=D" << std::endl;
             }
-            else if (segment == "static") {
+            else if (segment == Segment::STATIC) {
                 outFile << "@SP" << std::endl;
                 outFile << "AM=M-1" << std::endl;
                 outFile << "D=M" << std::endl;
@@ -0,0 +1,61 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 只读内存映射文件，整个文件只读一次，析构时自动解除映射
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    bool opened;
+
+public:
+    MappedFile(const std::string& filename) : data(nullptr), length(0), opened(false) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat statbuf;
+        if (fstat(fd, &statbuf) == 0) {
+            opened = true;
+            // 空文件无法映射，保持 length == 0 即可
+            if (statbuf.st_size > 0) {
+                void* addr = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED) {
+                    data = static_cast<const char*>(addr);
+                    length = static_cast<size_t>(statbuf.st_size);
+                    madvise(addr, length, MADV_SEQUENTIAL);
+                } else {
+                    opened = false;
+                }
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const {
+        return opened;
+    }
+
+    std::string_view view() const {
+        return std::string_view(data, length);
+    }
+};
+
+#endif
@@ -1,9 +1,14 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <string>
-#include <fstream>
-#include <cctype>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "MappedFile.h"
 
 enum CommandType {
     C_ARITHMETIC,   // add, sub, neg, eq, gt, lt, and, or, not
@@ -17,117 +22,291 @@ enum CommandType {
     C_CALL          // call functionName nArgs
 };
 
+// VM 命令的操作码，算术命令各占一个
+enum class Opcode : uint8_t {
+    ADD, SUB, NEG, EQ, GT, LT, AND, OR, NOT,
+    PUSH, POP,
+    LABEL, GOTO, IF_GOTO,
+    FUNCTION, CALL, RETURN,
+    INVALID
+};
+
+enum class Segment : uint8_t {
+    NONE, CONSTANT, LOCAL, ARGUMENT, THIS, THAT, TEMP, POINTER, STATIC,
+    INVALID
+};
+
+// 预先解码的 VM 命令：每行只解析一次，之后按枚举分派
+struct VMCommand {
+    Opcode opcode;
+    Segment segment; // push / pop
+    int index;       // push / pop 的下标，function 的局部变量数，call 的参数个数
+    uint32_t symbol; // label / goto / if-goto / function / call 的符号 id，见 VMSymbols
+    size_t line;     // 源文件中的行号，用于报错
+};
+
+inline CommandType commandType(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PUSH:     return C_PUSH;
+        case Opcode::POP:      return C_POP;
+        case Opcode::LABEL:    return C_LABEL;
+        case Opcode::GOTO:     return C_GOTO;
+        case Opcode::IF_GOTO:  return C_IF;
+        case Opcode::FUNCTION: return C_FUNCTION;
+        case Opcode::CALL:     return C_CALL;
+        case Opcode::RETURN:   return C_RETURN;
+        default:               return C_ARITHMETIC;
+    }
+}
+
+inline const char* opcodeName(Opcode opcode) {
+    static const char* const NAMES[] = {
+        "add", "sub", "neg", "eq", "gt", "lt", "and", "or", "not",
+        "push", "pop", "label", "goto", "if-goto", "function", "call", "return", "?"
+    };
+    return NAMES[static_cast<int>(opcode)];
+}
+
+inline const char* segmentName(Segment segment) {
+    static const char* const NAMES[] = {
+        "", "constant", "local", "argument", "this", "that", "temp", "pointer", "static", "?"
+    };
+    return NAMES[static_cast<int>(segment)];
+}
+
+// 标签名、函数名的驻留表：目录模式下所有文件共用，同名符号只保存一次
+class VMSymbols {
+private:
+    std::deque<std::string> names; // deque 追加时不移动已有元素，string_view 键保持有效
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+public:
+    uint32_t intern(std::string_view name) {
+        auto found = ids.find(name);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    const std::string& name(uint32_t id) const {
+        return names[id];
+    }
+
+    size_t size() const {
+        return names.size();
+    }
+};
+
+// 解析器：把整个 .vm 文件内存映射进来，逐行切出单词直接解码成 VMCommand，
+// 不再为每行构造 std::string，也不在取参数时反复拆分
 class Parser {
 private:
-    std::ifstream file;
-    std::string currentCommand;
-
-    std::string trim(const std::string& str) {
-        size_t first = str.find_first_not_of(" \t\r\n");
-        if (first == std::string::npos) return "";
-        size_t last = str.find_last_not_of(" \t\r\n");
-        return str.substr(first, (last - first + 1));
+    std::vector<VMCommand> decoded;
+    std::vector<std::string> problems;
+    bool opened;
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
     }
 
-    std::string removeComments(const std::string& line) {
-        size_t pos = line.find("//");
-        if (pos != std::string::npos) {
-            return line.substr(0, pos);
+    // 取下一个以空白分隔的单词，没有时返回空
+    static std::string_view nextWord(std::string_view& rest) {
+        size_t start = 0;
+        while (start < rest.size() && isSpace(rest[start])) start++;
+        size_t end = start;
+        while (end < rest.size() && !isSpace(rest[end])) end++;
+        std::string_view word = rest.substr(start, end - start);
+        rest = rest.substr(end);
+        return word;
+    }
+
+    static Opcode decodeOpcode(std::string_view word) {
+        switch (word.size()) {
+            case 2:
+                if (word == "eq") return Opcode::EQ;
+                if (word == "gt") return Opcode::GT;
+                if (word == "lt") return Opcode::LT;
+                if (word == "or") return Opcode::OR;
+                break;
+            case 3:
+                if (word == "add") return Opcode::ADD;
+                if (word == "sub") return Opcode::SUB;
+                if (word == "neg") return Opcode::NEG;
+                if (word == "and") return Opcode::AND;
+                if (word == "not") return Opcode::NOT;
+                if (word == "pop") return Opcode::POP;
+                break;
+            case 4:
+                if (word == "push") return Opcode::PUSH;
+                if (word == "goto") return Opcode::GOTO;
+                if (word == "call") return Opcode::CALL;
+                break;
+            case 5:
+                if (word == "label") return Opcode::LABEL;
+                break;
+            case 6:
+                if (word == "return") return Opcode::RETURN;
+                break;
+            case 7:
+                if (word == "if-goto") return Opcode::IF_GOTO;
+                break;
+            case 8:
+                if (word == "function") return Opcode::FUNCTION;
+                break;
         }
-        return line;
+        return Opcode::INVALID;
     }
 
-public:
-    Parser(const std::string& filename) {
-        file.open(filename);
+    static Segment decodeSegment(std::string_view word) {
+        switch (word.empty() ? '\0' : word[0]) {
+            case 'c': if (word == "constant") return Segment::CONSTANT; break;
+            case 'l': if (word == "local") return Segment::LOCAL; break;
+            case 'a': if (word == "argument") return Segment::ARGUMENT; break;
+            case 't':
+                if (word == "this") return Segment::THIS;
+                if (word == "that") return Segment::THAT;
+                if (word == "temp") return Segment::TEMP;
+                break;
+            case 'p': if (word == "pointer") return Segment::POINTER; break;
+            case 's': if (word == "static") return Segment::STATIC; break;
+        }
+        return Segment::INVALID;
     }
 
-    ~Parser() {
-        if (file.is_open()) {
-            file.close();
+    static constexpr int MAX_INDEX = 32767;
+
+    // 非负十进制整数，格式不对时返回 -1
+    static int decodeIndex(std::string_view word) {
+        if (word.empty() || word.size() > 9) return -1;
+        int value = 0;
+        for (char c : word) {
+            if (c < '0' || c > '9') return -1;
+            value = value * 10 + (c - '0');
         }
+        return value;
     }
 
-    bool hasMoreCommands() {
-        return !file.eof();
+    void error(size_t line, const std::string& message) {
+        problems.push_back("第 " + std::to_string(line) + " 行: " + message);
     }
 
-    void advance() {
-        std::string line;
-        while (std::getline(file, line)) {
-            line = trim(removeComments(line));
-            if (!line.empty()) {
-                currentCommand = line;
+    void decodeLine(std::string_view line, size_t lineNumber, VMSymbols& symbols) {
+        std::string_view rest = line;
+        std::string_view word = nextWord(rest);
+        if (word.empty()) {
+            return;
+        }
+
+        VMCommand command = {decodeOpcode(word), Segment::NONE, 0, 0, lineNumber};
+        switch (command.opcode) {
+            case Opcode::INVALID:
+                error(lineNumber, "未知命令 " + std::string(word));
                 return;
+            case Opcode::PUSH:
+            case Opcode::POP: {
+                std::string_view segment = nextWord(rest);
+                command.segment = decodeSegment(segment);
+                command.index = decodeIndex(nextWord(rest));
+                if (command.segment == Segment::INVALID) {
+                    error(lineNumber, "未知的段 " + std::string(segment));
+                    return;
+                }
+                if (command.index < 0) {
+                    error(lineNumber, "下标应为非负整数");
+                    return;
+                }
+                // A 指令只有 15 位，更大的常量或下标没有办法装入
+                if (command.index > MAX_INDEX) {
+                    error(lineNumber, std::string(command.segment == Segment::CONSTANT ? "常量" : "下标") +
+                                          "超出 0.." + std::to_string(MAX_INDEX));
+                    return;
+                }
+                if (command.opcode == Opcode::POP && command.segment == Segment::CONSTANT) {
+                    error(lineNumber, "不能 pop 到 constant 段");
+                    return;
+                }
+                if ((command.segment == Segment::POINTER && command.index > 1) ||
+                    (command.segment == Segment::TEMP && command.index > 7)) {
+                    error(lineNumber, std::string(segmentName(command.segment)) + " 段下标越界");
+                    return;
+                }
+                break;
+            }
+            case Opcode::LABEL:
+            case Opcode::GOTO:
+            case Opcode::IF_GOTO:
+            case Opcode::FUNCTION:
+            case Opcode::CALL: {
+                std::string_view symbol = nextWord(rest);
+                if (symbol.empty()) {
+                    error(lineNumber, std::string(opcodeName(command.opcode)) + " 缺少符号");
+                    return;
+                }
+                command.symbol = symbols.intern(symbol);
+                if (command.opcode == Opcode::FUNCTION || command.opcode == Opcode::CALL) {
+                    command.index = decodeIndex(nextWord(rest));
+                    if (command.index < 0) {
+                        error(lineNumber, "参数个数应为非负整数");
+                        return;
+                    }
+                }
+                break;
             }
+            default:
+                break;
         }
-        currentCommand = "";
-    }
-
-    CommandType commandType() {
-        if (currentCommand.empty()) {
-            return C_ARITHMETIC;
+        std::string_view extra = nextWord(rest);
+        if (!extra.empty()) {
+            error(lineNumber, std::string(opcodeName(command.opcode)) + " 之后有多余的内容 " + std::string(extra));
+            return;
         }
-
-        // 提取第一个单词
-        size_t pos = currentCommand.find(' ');
-        std::string cmd = (pos != std::string::npos) 
-                         ? currentCommand.substr(0, pos) 
-                         : currentCommand;
-
-        if (cmd == "push") return C_PUSH;
-        if (cmd == "pop") return C_POP;
-        if (cmd == "label") return C_LABEL;
-        if (cmd == "goto") return C_GOTO;
-        if (cmd == "if-goto") return C_IF;
-        if (cmd == "function") return C_FUNCTION;
-        if (cmd == "return") return C_RETURN;
-        if (cmd == "call") return C_CALL;
-        
-        // 否则是算术/逻辑命令
-        return C_ARITHMETIC;
+        decoded.push_back(command);
     }
 
-    std::string arg1() {
-        // 对于 C_ARITHMETIC，返回命令本身
-        // 对于其他命令，返回第一个参数
-        CommandType type = commandType();
-        
-        if (type == C_ARITHMETIC) {
-            return currentCommand;
+public:
+    Parser(const std::string& filename, VMSymbols& symbols) : opened(false) {
+        MappedFile file(filename);
+        if (!file.isOpen()) {
+            return;
         }
+        opened = true;
 
-        // 提取第一个参数
-        size_t firstSpace = currentCommand.find(' ');
-        if (firstSpace == std::string::npos) return "";
-        
-        size_t secondSpace = currentCommand.find(' ', firstSpace + 1);
-        if (secondSpace == std::string::npos) {
-            return currentCommand.substr(firstSpace + 1);
+        std::string_view source = file.view();
+        decoded.reserve(source.size() / 12);
+        const char* cursor = source.data();
+        const char* limit = source.data() + source.size();
+        size_t lineNumber = 0;
+        while (cursor < limit) {
+            lineNumber++;
+            const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', limit - cursor));
+            const char* lineEnd = (newline != nullptr) ? newline : limit;
+            std::string_view line(cursor, lineEnd - cursor);
+            cursor = (newline != nullptr) ? newline + 1 : limit;
+
+            size_t comment = line.find("//");
+            if (comment != std::string_view::npos) {
+                line = line.substr(0, comment);
+            }
+            decodeLine(line, lineNumber, symbols);
         }
-        
-        return currentCommand.substr(firstSpace + 1, secondSpace - firstSpace - 1);
     }
 
-    int arg2() {
-        // 只对 C_PUSH, C_POP, C_FUNCTION, C_CALL 有效
-        size_t firstSpace = currentCommand.find(' ');
-        if (firstSpace == std::string::npos) return 0;
-        
-        size_t secondSpace = currentCommand.find(' ', firstSpace + 1);
-        if (secondSpace == std::string::npos) return 0;
-        
-        std::string arg = currentCommand.substr(secondSpace + 1);
-        return std::stoi(arg);
+    bool isOpen() const {
+        return opened;
     }
 
-    std::string getCurrentCommand() const {
-        return currentCommand;
+    // 按源码顺序排列的全部命令
+    const std::vector<VMCommand>& commands() const {
+        return decoded;
     }
 
-    void reset() {
-        file.clear();
-        file.seekg(0, std::ios::beg);
+    // 无法解码的行，格式为 "第 N 行: 原因"
+    const std::vector<std::string>& errors() const {
+        return problems;
     }
 };
 
@@ -12,29 +12,33 @@ int main(int argc, char* argv[]) {
     std::string inputFile = argv[1];
     std::string outputFile = inputFile.substr(0, inputFile.find_last_of('.')) + ".asm";
 
-    Parser parser(inputFile);
+    VMSymbols symbols;
+    Parser parser(inputFile, symbols);
+    if (!parser.isOpen()) {
+        std::cerr << "无法打开输入文件: " << inputFile << std::endl;
+        return 1;
+    }
+    if (!parser.errors().empty()) {
+        for (const std::string& error : parser.errors()) {
+            std::cerr << inputFile << ": " << error << std::endl;
+        }
+        return 1;
+    }
+
     CodeWriter writer(outputFile);
 
     // 设置当前文件名（用于 static 段）
     writer.setFileName(inputFile);
 
-    // 翻译 VM 命令
-    while (parser.hasMoreCommands()) {
-        parser.advance();
-
-        // 跳过空命令
-        if (parser.getCurrentCommand().empty()) {
-            break;
-        }
-
-        CommandType cmdType = parser.commandType();
+    // 解析器已把整个文件解码成 VMCommand，按操作码分派
+    for (const VMCommand& command : parser.commands()) {
+        CommandType cmdType = commandType(command.opcode);
 
         if (cmdType == C_ARITHMETIC) {
-            writer.writeArithmetic(parser.arg1());
+            writer.writeArithmetic(command.opcode);
         }
         else if (cmdType == C_PUSH || cmdType == C_POP) {
-            std::string command = (cmdType == C_PUSH) ? "push" : "pop";
-            writer.writePushPop(command, parser.arg1(), parser.arg2());
+            writer.writePushPop(command.opcode, command.segment, command.index);
         }
         // Project 7 不需要处理其他命令类型
     }
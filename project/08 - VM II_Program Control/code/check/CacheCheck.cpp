@@ -0,0 +1,72 @@
+// 栈顶缓存检查：算术、比较、push/pop 的每条缓存路径至少一个用例（栈顶在 D 中 / 在内存中），
+// 分别在关闭和开启 --tos-cache 时翻译，在 Hack CPU 模拟器上从相同的随机初始内存运行两份机器码，
+// 比较结束时的内存；比较命令在 inline 和 shared 两种方式下各检查一遍，并要求缓存后周期不增加。
+// cd "project/08 - VM II_Program Control/code/src"
+// make test-tos-cache
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Equivalence.h"
+
+struct CacheCase {
+    const char* name;
+    const char* source;
+};
+
+static const CacheCase CASES[] = {
+    // 二元运算：第二个操作数在 D 中
+    {"binary", "push local 0\npush local 1\nadd\npush local 2\nsub\npush argument 0\nand\npush argument 1\nor\n"
+               "pop local 3\n"},
+    // 两个操作数都在栈上：D 中没有缓存时先弹出
+    {"binary-memory", "add\nsub\nand\nor\npop temp 0\n"},
+    {"unary", "push argument 0\nneg\npush argument 1\nnot\nor\npop temp 0\n"},
+    {"unary-memory", "neg\nnot\nneg\npop temp 1\n"},
+    {"compare", "push local 0\npush local 1\nlt\npush local 1\npush local 0\ngt\npush local 0\npush local 0\neq\n"
+                "and\nor\npop static 0\n"},
+    {"compare-memory", "eq\nlt\ngt\npop temp 2\n"},
+    // x-y 溢出时与不缓存的结果相同
+    {"compare-overflow", "push constant 20000\nneg\npush constant 20000\ngt\npush constant 20000\n"
+                         "push constant 20000\nneg\nlt\npop temp 3\npop temp 4\n"},
+    // label 前写回 D，之后从内存取操作数
+    {"flush", "push local 0\nlabel L\npush local 1\nlt\npop temp 0\npush argument 0\ngoto M\nlabel M\nneg\npop temp 1\n"},
+    {"if-goto", "push local 0\npush local 1\ngt\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"
+                "push argument 0\nif-goto END\npush constant 2\npop temp 1\nlabel END\n"},
+    {"push-pop", "push this 2\npop that 3\npush pointer 0\npop temp 7\npush static 3\npop argument 12\n"
+                 "push constant 0\npop local 9\npush temp 7\npop pointer 1\npush that 0\npop this 1\n"},
+    // 结束时栈顶还在 D 中，close() 写回
+    {"leave-on-stack", "push local 0\npush local 1\nadd\npush constant 7\n"},
+};
+
+static CodeGenOptions optionsFor(bool tosCache, CompareMode compare) {
+    CodeGenOptions options;
+    options.tosCache = tosCache;
+    options.compare = compare;
+    return options;
+}
+
+int main() {
+    int failures = 0;
+    for (CompareMode compare : {CompareMode::INLINE, CompareMode::SHARED}) {
+        const char* mode = compare == CompareMode::INLINE ? "" : " (compare=shared)";
+        for (const CacheCase& check : CASES) {
+            std::vector<uint16_t> plain = translate(check.source, optionsFor(false, compare));
+            std::vector<uint16_t> cached = translate(check.source, optionsFor(true, compare));
+            Comparison result = compareRuns(plain, cached);
+            if (result.problem.empty() && result.actualCycles > result.expectedCycles) {
+                result.problem = "周期反而增加";
+            }
+
+            std::cout << (result.problem.empty() ? "PASS " : "FAIL ") << check.name << mode << ": ROM "
+                      << plain.size() << " -> " << cached.size() << "，周期 " << result.expectedCycles << " -> "
+                      << result.actualCycles;
+            if (!result.problem.empty()) {
+                std::cout << "  " << result.problem;
+                failures++;
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::cout << (failures == 0 ? "全部栈顶缓存检查通过" : std::to_string(failures) + " 项检查失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
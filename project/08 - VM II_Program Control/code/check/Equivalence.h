@@ -0,0 +1,147 @@
+#ifndef EQUIVALENCE_H
+#define EQUIVALENCE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CodeWriter.h"
+#include "HackCPU.h"
+#include "Parser.h"
+
+// 检查程序共用的测试装置：把 VM 源码翻译成机器码，两份机器码从相同的随机内存出发运行，比较结束时的内存。
+// 各检查程序只需给出用例表和翻译选项
+
+// xorshift64*
+inline uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ull;
+}
+
+// 段的基址。sameState 不比较栈顶以上的位置，local / argument 必须放在 SP 之下，
+// 否则写入它们的用例什么也检查不到；每段留出 SEGMENT_SPAN 个位置，彼此不重叠
+constexpr int16_t CHECK_SP = 600;  // 下面留有可以弹出的值
+constexpr int16_t CHECK_LCL = 400;
+constexpr int16_t CHECK_ARG = 300;
+constexpr int16_t CHECK_THIS = 3000;
+constexpr int16_t CHECK_THAT = 3100;
+constexpr int16_t SEGMENT_SPAN = 100;
+static_assert(CHECK_ARG + SEGMENT_SPAN <= CHECK_LCL && CHECK_LCL + SEGMENT_SPAN <= CHECK_SP,
+              "local / argument 必须在栈顶之下才会被比较");
+static_assert(CHECK_THIS >= 2048 && CHECK_THIS + SEGMENT_SPAN <= CHECK_THAT, "this / that 必须在栈区之外且不重叠");
+
+// 段指针指向上面的区域，其余内存随机
+inline void randomize(HackCPU& cpu, uint64_t seed) {
+    uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (int16_t& word : cpu.ram) {
+        word = static_cast<int16_t>(nextRandom(state));
+    }
+    cpu.ram[0] = CHECK_SP;
+    cpu.ram[1] = CHECK_LCL;
+    cpu.ram[2] = CHECK_ARG;
+    cpu.ram[3] = CHECK_THIS;
+    cpu.ram[4] = CHECK_THAT;
+}
+
+// R13-R15 是代码生成的临时寄存器，栈顶以上是已经弹出的位置，都不参与比较；
+// [ignoreBegin, ignoreEnd) 是调用者额外排除的区间（如内联代码自己的槽位）
+inline bool sameState(const HackCPU& expected, const HackCPU& actual, std::string& difference,
+                      size_t ignoreBegin = 0, size_t ignoreEnd = 0) {
+    int sp = expected.ram[0];
+    for (size_t address = 0; address < 16384; address++) {
+        if (address >= 13 && address <= 15) continue;
+        if (static_cast<int>(address) >= sp && address < 2048) continue;
+        if (address >= ignoreBegin && address < ignoreEnd) continue;
+        if (expected.ram[address] != actual.ram[address]) {
+            difference = "RAM[" + std::to_string(address) + "] 应为 " + std::to_string(expected.ram[address]) +
+                         "，实际为 " + std::to_string(actual.ram[address]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 每个用例运行的随机初始内存组数
+constexpr uint64_t CHECK_SEEDS = 8;
+
+// 依次以种子 1..CHECK_SEEDS 调用 check(seed)，返回第一个问题，空串表示全部通过
+template <typename Fn>
+std::string forEachSeed(Fn check) {
+    for (uint64_t seed = 1; seed <= CHECK_SEEDS; seed++) {
+        std::string problem = check(seed);
+        if (!problem.empty()) {
+            return problem;
+        }
+    }
+    return "";
+}
+
+// 代码生成之前对解码后的命令做的变换（peephole、控制流、内联），可以为空
+using VMPass = std::function<void(std::vector<VMCommand>& commands, VMSymbols& symbols)>;
+
+// 翻译成机器码：输出写到 /dev/null，机器码直接取自内存中的 HackIR。close() 写回缓存在 D 中的栈顶。
+// 生成不了机器码说明用例或翻译器有错，后面的比较没有意义，直接以失败退出
+inline std::vector<uint16_t> machineCode(CodeWriter& writer) {
+    writer.close();
+    std::vector<uint16_t> words;
+    std::string error;
+    if (!writer.code().toMachineCode(words, error)) {
+        std::cerr << "无法生成机器码: " << error << std::endl;
+        std::exit(1);
+    }
+    return words;
+}
+
+inline std::vector<uint16_t> translate(std::string_view source, const CodeGenOptions& options = {},
+                                       const VMPass& pass = nullptr) {
+    VMSymbols symbols;
+    Parser parser = Parser::fromSource(source, symbols, "Check.vm");
+    std::vector<VMCommand> commands = parser.commands();
+    if (pass) {
+        pass(commands, symbols);
+    }
+    CodeWriter writer("/dev/null", EmitFormat::ASM, options);
+    writer.setFileName("Check.vm");
+    for (const VMCommand& command : commands) {
+        writer.writeCommand(command, symbols);
+    }
+    return machineCode(writer);
+}
+
+struct Comparison {
+    std::string problem;         // 第一处差异，空串表示相同
+    uint64_t expectedCycles = 0; // 所有种子上累计的周期数
+    uint64_t actualCycles = 0;
+};
+
+// 两份机器码在每组随机内存上各自运行（最多 limit 个周期），用 sameState 比较结束时的内存
+inline Comparison compareRuns(const std::vector<uint16_t>& expectedRom, const std::vector<uint16_t>& actualRom,
+                              size_t ignoreBegin = 0, size_t ignoreEnd = 0, uint64_t limit = 1000000) {
+    Comparison result;
+    result.problem = forEachSeed([&](uint64_t seed) {
+        HackCPU expected;
+        HackCPU actual;
+        expected.rom = expectedRom;
+        actual.rom = actualRom;
+        randomize(expected, seed);
+        randomize(actual, seed);
+        bool finished = expected.run(limit) && actual.run(limit);
+        result.expectedCycles += expected.cycles;
+        result.actualCycles += actual.cycles;
+        std::string difference;
+        if (!finished) {
+            difference = "程序没有结束";
+        } else {
+            sameState(expected, actual, difference, ignoreBegin, ignoreEnd);
+        }
+        return difference;
+    });
+    return result;
+}
+
+#endif
@@ -0,0 +1,140 @@
+// 控制流优化检查：每种变换至少一个用例，分别在关闭和开启优化时翻译同一个函数，
+// 确认变换确实发生，并在 Hack CPU 模拟器上从相同的随机初始内存运行两份机器码，比较结束时的内存。
+// 开启 --peephole 时还要求执行的周期数减少（反转条件加上的 not 要经过 peephole 才会合并）。
+// 所有用例再在 --tos-cache 下检查一遍。
+// cd "project/08 - VM II_Program Control/code/src"
+// make test-control-flow
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ControlFlow.h"
+#include "Equivalence.h"
+#include "Peephole.h"
+
+struct FlowCase {
+    const char* change; // 应当发生的变换，空串表示只检查等价
+    const char* source;
+};
+
+static const FlowCase CASES[] = {
+    // while：条件复制到循环末尾
+    {"rotated",
+     "function Check.loop 0\npush argument 0\npush constant 15\nand\npop local 0\npush constant 0\npop local 1\n"
+     "label WHILE_EXP0\npush local 0\npush constant 0\ngt\nnot\nif-goto WHILE_END0\n"
+     "push local 1\npush local 0\nadd\npop local 1\npush local 0\npush constant 1\nsub\npop local 0\n"
+     "goto WHILE_EXP0\nlabel WHILE_END0\n"},
+    // 循环体为空：反转条件后就是跳回循环头的条件跳转
+    {"inverted",
+     "function Check.spin 0\npush argument 0\npush constant 7\nand\npop local 0\n"
+     "label WHILE_EXP0\npush local 0\npush constant 1\nsub\npop local 0\npush local 0\npush constant 0\ngt\nnot\n"
+     "if-goto WHILE_END0\ngoto WHILE_EXP0\nlabel WHILE_END0\n"},
+    // if / else：if-goto 跳过 goto
+    {"inverted",
+     "function Check.branch 0\npush argument 0\npush argument 1\nlt\nif-goto IF_TRUE0\ngoto IF_FALSE0\n"
+     "label IF_TRUE0\npush constant 1\npop temp 0\ngoto IF_END0\nlabel IF_FALSE0\npush constant 2\npop temp 0\n"
+     "label IF_END0\n"},
+    {"inverted",
+     "function Check.branch 0\npush argument 0\npush argument 0\neq\nnot\nif-goto IF_TRUE0\ngoto IF_FALSE0\n"
+     "label IF_TRUE0\npush constant 1\npop temp 0\nlabel IF_FALSE0\n"},
+    // 跳到只有 goto 的块
+    {"threaded",
+     "function Check.thread 0\npush argument 0\npush argument 1\ngt\nif-goto A\npush constant 1\npop temp 1\n"
+     "goto B\nlabel A\ngoto C\nlabel B\npush constant 2\npop temp 2\nlabel C\n"},
+    {"removed-jumps",
+     "function Check.next 0\npush argument 0\npop temp 0\ngoto NEXT\nlabel NEXT\npush argument 1\npop temp 1\n"},
+    {"removed-blocks",
+     "function Check.dead 0\npush argument 0\npop temp 0\ngoto END\npush argument 1\npop temp 1\nlabel END\n"},
+    // 条件不一定是 -1/0，不能反转：while (x) 与 if (x)
+    {"",
+     "function Check.value 0\npush argument 0\npush constant 3\nand\npop local 0\n"
+     "label WHILE_EXP0\npush local 0\nif-goto BODY\ngoto WHILE_END0\nlabel BODY\n"
+     "push local 0\npush constant 1\nsub\npop local 0\ngoto WHILE_EXP0\nlabel WHILE_END0\n"},
+    {"",
+     "function Check.value 0\npush constant 0\nnot\npop local 0\n"
+     "label WHILE_EXP0\npush local 0\nnot\nif-goto WHILE_END0\n"
+     "push local 0\npush constant 2\nadd\npop local 0\ngoto WHILE_EXP0\nlabel WHILE_END0\n"},
+};
+
+static size_t changeCount(const ControlFlow::Stats& stats, const std::string& change) {
+    if (change == "threaded") return stats.threaded;
+    if (change == "removed-jumps") return stats.removedJumps;
+    if (change == "inverted") return stats.inverted;
+    if (change == "rotated") return stats.rotated;
+    if (change == "removed-blocks") return stats.removedBlocks;
+    if (change == "removed-labels") return stats.removedLabels;
+    return 0;
+}
+
+static std::vector<uint16_t> translate(const char* source, bool flow, bool peephole, bool tosCache,
+                                       ControlFlow::Stats& stats) {
+    CodeGenOptions options;
+    options.tosCache = tosCache;
+    return translate(source, options, [&](std::vector<VMCommand>& commands, VMSymbols& symbols) {
+        if (flow) {
+            ControlFlow optimizer(symbols);
+            optimizer.optimize(commands);
+            stats = optimizer.stats();
+        }
+        if (peephole) {
+            Peephole rules;
+            commands = rules.optimize(commands);
+        }
+    });
+}
+
+// 检查一个用例，返回发现的问题，空串表示通过
+static std::string checkCase(const FlowCase& check, bool tosCache) {
+    std::string change = check.change;
+    ControlFlow::Stats stats;
+    ControlFlow::Stats unused;
+
+    Comparison cache;
+    if (tosCache) {
+        // 栈顶缓存本身先与不缓存的代码比较
+        cache = compareRuns(translate(check.source, false, false, false, unused),
+                            translate(check.source, false, false, true, unused));
+    }
+    Comparison flow;
+    Comparison both;
+    std::string problem = cache.problem;
+    if (problem.empty()) {
+        flow = compareRuns(translate(check.source, false, false, tosCache, unused),
+                           translate(check.source, true, false, tosCache, stats));
+        problem = flow.problem;
+    }
+    if (problem.empty()) {
+        both = compareRuns(translate(check.source, false, true, tosCache, unused),
+                           translate(check.source, true, true, tosCache, unused));
+        problem = both.problem;
+    }
+    if (problem.empty() && !change.empty()) {
+        if (changeCount(stats, change) == 0) {
+            problem = "没有发生变换";
+        } else if (both.actualCycles >= both.expectedCycles) {
+            problem = "周期没有减少";
+        }
+    }
+
+    std::cout << (problem.empty() ? "PASS " : "FAIL ") << (change.empty() ? "unchanged" : change)
+              << (tosCache ? " (tos-cache)" : "") << ": 周期 " << flow.expectedCycles << " -> " << flow.actualCycles
+              << "，peephole " << both.expectedCycles << " -> " << both.actualCycles;
+    if (!problem.empty()) {
+        std::cout << "  " << problem;
+    }
+    std::cout << std::endl;
+    return problem;
+}
+
+int main() {
+    int failures = 0;
+    for (bool tosCache : {false, true}) {
+        for (const FlowCase& check : CASES) {
+            if (!checkCase(check, tosCache).empty()) {
+                failures++;
+            }
+        }
+    }
+    std::cout << (failures == 0 ? "全部控制流检查通过" : std::to_string(failures) + " 项检查失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
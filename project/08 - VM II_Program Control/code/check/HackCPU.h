@@ -0,0 +1,62 @@
+#ifndef HACKCPU_H
+#define HACKCPU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 最小的 Hack CPU 模拟器：只有 ROM、RAM 和 A/D/PC 寄存器，用于在测试中对比两段机器码的效果
+struct HackCPU {
+    static constexpr size_t RAM_SIZE = 32768;
+
+    std::vector<uint16_t> rom;
+    std::vector<int16_t> ram = std::vector<int16_t>(RAM_SIZE, 0);
+    int16_t a = 0;
+    int16_t d = 0;
+    uint16_t pc = 0;
+    uint64_t cycles = 0;
+
+    // ALU：c1..c6 依次为 zx nx zy ny f no
+    static int16_t alu(int16_t x, int16_t y, unsigned bits) {
+        if (bits & 0x20) x = 0;
+        if (bits & 0x10) x = static_cast<int16_t>(~x);
+        if (bits & 0x08) y = 0;
+        if (bits & 0x04) y = static_cast<int16_t>(~y);
+        int16_t out = (bits & 0x02) ? static_cast<int16_t>(static_cast<uint16_t>(x) + static_cast<uint16_t>(y))
+                                    : static_cast<int16_t>(x & y);
+        if (bits & 0x01) out = static_cast<int16_t>(~out);
+        return out;
+    }
+
+    void step() {
+        uint16_t word = rom[pc];
+        cycles++;
+        if ((word & 0x8000) == 0) {
+            a = static_cast<int16_t>(word);
+            pc++;
+            return;
+        }
+        uint16_t address = static_cast<uint16_t>(a) & (RAM_SIZE - 1);
+        int16_t y = (word & 0x1000) ? ram[address] : a;
+        int16_t out = alu(d, y, (word >> 6) & 0x3F);
+        bool jump = ((word & 4) && out < 0) || ((word & 2) && out == 0) || ((word & 1) && out > 0);
+        uint16_t target = static_cast<uint16_t>(a);
+        if (word & 0x08) ram[address] = out;
+        if (word & 0x10) d = out;
+        if (word & 0x20) a = out;
+        pc = jump ? target : static_cast<uint16_t>(pc + 1);
+    }
+
+    // 运行到 PC 越过程序末尾为止，超过 limit 个周期时返回 false
+    bool run(uint64_t limit) {
+        while (pc < rom.size()) {
+            if (cycles >= limit) {
+                return false;
+            }
+            step();
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,124 @@
+// 内联检查：每个用例是一个小程序，Check.main 调用若干叶子函数。分别在关闭和开启内联时翻译，
+// 确认内联的调用处个数与预期相同，并在 Hack CPU 模拟器上从相同的随机初始内存运行两份机器码，比较结束时的内存；
+// 有调用处被内联时还要求周期减少。用例覆盖多个调用处共用槽位、改写 pointer 0/1、多个 return、
+// 函数体中的循环标签，以及不满足条件而不内联的函数。
+// cd "project/08 - VM II_Program Control/code/src"
+// make test-inline
+
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Equivalence.h"
+#include "Inliner.h"
+
+struct InlineCase {
+    const char* name;
+    size_t limit;   // 函数体长度上限
+    size_t sites;   // 应当内联的调用处个数
+    const char* callees;
+    const char* main;
+};
+
+// 程序的开头调用 Check.main，它放在最后，执行到 ROM 末尾时结束。返回地址紧跟在开头的 call 之后，
+// 两份机器码中相同。static 只在被调用的函数中使用，它们出现在内联的代码之前，两份机器码中地址相同
+static const InlineCase CASES[] = {
+    // 三个调用处共用槽位；局部变量在每个调用处都要清零
+    {"slots", Inliner::DEFAULT_LIMIT, 3,
+     "function Check.mix 2\npush local 1\npush argument 0\nadd\npush argument 1\nsub\npop local 0\n"
+     "push local 0\npush argument 2\nadd\npop local 1\npush local 1\nreturn\n",
+     "push this 0\npush this 1\npush this 2\ncall Check.mix 3\npop local 0\n"
+     "push local 0\npush constant 3\npush that 0\ncall Check.mix 3\npop local 1\n"
+     "push local 1\npush local 0\npush constant 17\ncall Check.mix 3\n"},
+    // 函数体中的 static 仍是被调用者文件的变量
+    {"static", Inliner::DEFAULT_LIMIT, 2,
+     "function Check.count 0\npush static 0\npush argument 0\nadd\npop static 0\npush static 0\nreturn\n",
+     "push this 0\ncall Check.count 1\npop local 0\npush constant 5\ncall Check.count 1\n"},
+    // 改写 pointer 0/1，调用者的 THIS/THAT 在 return 处恢复
+    {"pointer", Inliner::DEFAULT_LIMIT, 2,
+     "function Check.poke 0\npush argument 0\npop pointer 1\npush argument 1\npop that 0\npush constant 0\nreturn\n"
+     "function Check.shift 0\npush argument 0\npop pointer 0\npush this 0\npush argument 1\nadd\npop this 1\n"
+     "push this 1\nreturn\n",
+     "push constant 3050\npush this 5\ncall Check.poke 2\npop temp 0\npush that 0\npop local 0\n"
+     "push constant 3110\npush that 1\ncall Check.shift 2\npop local 1\npush this 0\npush that 0\nadd\n"},
+    // 多个 return 改为跳到内联代码末尾；同一个函数的两个调用处使用不同的标签前缀
+    {"returns", Inliner::DEFAULT_LIMIT, 4,
+     "function Check.max 0\npush argument 0\npush argument 1\ngt\nif-goto FIRST\npush argument 1\nreturn\n"
+     "label FIRST\npush argument 0\nreturn\n"
+     "function Check.abs 0\npush argument 0\npush constant 0\nlt\nif-goto NEG\npush argument 0\nreturn\n"
+     "label NEG\npush argument 0\nneg\nreturn\n",
+     "push this 0\npush this 1\ncall Check.max 2\npop local 0\npush that 0\npush local 0\ncall Check.max 2\n"
+     "call Check.abs 1\npop local 1\npush this 2\ncall Check.abs 1\n"},
+    // 函数体中的循环：标签在每个调用处各有一份
+    {"loop", 20, 2,
+     "function Check.sum 1\npush argument 0\npush constant 7\nand\npop argument 0\nlabel LOOP\n"
+     "push argument 0\nif-goto BODY\npush local 0\nreturn\nlabel BODY\npush local 0\npush argument 0\nadd\n"
+     "pop local 0\npush argument 0\npush constant 1\nsub\npop argument 0\ngoto LOOP\n",
+     "push this 0\ncall Check.sum 1\npop local 0\npush that 0\ncall Check.sum 1\npop local 1\n"},
+    // 只有 Check.abs 可以内联：Check.sum 超过长度上限，Check.outer 中有 call，Check.drop 弹出调用者的栈
+    {"rejected", Inliner::DEFAULT_LIMIT, 1,
+     "function Check.sum 1\npush argument 0\npush constant 7\nand\npop argument 0\nlabel LOOP\n"
+     "push argument 0\nif-goto BODY\npush local 0\nreturn\nlabel BODY\npush local 0\npush argument 0\nadd\n"
+     "pop local 0\npush argument 0\npush constant 1\nsub\npop argument 0\ngoto LOOP\n"
+     "function Check.outer 0\npush argument 0\ncall Check.sum 1\nreturn\n"
+     "function Check.drop 0\npop temp 0\npush constant 1\nreturn\n"
+     "function Check.abs 0\npush argument 0\npush constant 0\nlt\nif-goto NEG\npush argument 0\nreturn\n"
+     "label NEG\npush argument 0\nneg\nreturn\n",
+     "push this 0\ncall Check.sum 1\npop local 0\npush this 1\ncall Check.outer 1\npop local 1\n"
+     "push this 2\ncall Check.drop 1\npush that 0\ncall Check.abs 1\n"},
+    // 调用处的参数个数少于函数体用到的参数
+    {"too-few-arguments", Inliner::DEFAULT_LIMIT, 0,
+     "function Check.second 0\npush argument 1\nreturn\n",
+     "push this 0\ncall Check.second 1\n"},
+};
+
+static std::string programOf(const InlineCase& check) {
+    return std::string("call Check.main 0\n") + check.callees + "function Check.main 2\n" + check.main;
+}
+
+// 检查一个用例，返回发现的问题，空串表示通过
+static std::string checkCase(const InlineCase& check, Comparison& result) {
+    std::string source = programOf(check);
+    size_t statics = 0;
+    size_t sites = 0;
+    std::vector<uint16_t> plain = translate(source);
+    std::vector<uint16_t> inlined = translate(source, {}, [&](std::vector<VMCommand>& commands, VMSymbols& symbols) {
+        std::set<std::pair<uint32_t, int>> variables;
+        for (const VMCommand& command : commands) {
+            if (command.segment == Segment::STATIC) variables.insert({command.symbol, command.index});
+        }
+        statics = variables.size();
+        std::vector<std::vector<VMCommand>> files = {commands};
+        sites = Inliner(check.limit).run(files, symbols);
+        commands.swap(files[0]);
+    });
+    if (sites != check.sites) {
+        return "内联了 " + std::to_string(sites) + " 处调用，应为 " + std::to_string(check.sites);
+    }
+
+    // 槽位（$inline.N）分配在 static 变量之后，是内联代码自己的临时变量，不参与比较
+    result = compareRuns(plain, inlined, 16 + statics, 256);
+    if (result.problem.empty() && sites > 0 && result.actualCycles >= result.expectedCycles) {
+        return "周期没有减少";
+    }
+    return result.problem;
+}
+
+int main() {
+    int failures = 0;
+    for (const InlineCase& check : CASES) {
+        Comparison result;
+        std::string problem = checkCase(check, result);
+        std::cout << (problem.empty() ? "PASS " : "FAIL ") << check.name << ": " << check.sites << " 处调用，周期 "
+                  << result.expectedCycles << " -> " << result.actualCycles;
+        if (!problem.empty()) {
+            std::cout << "  " << problem;
+            failures++;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << (failures == 0 ? "全部内联检查通过" : std::to_string(failures) + " 项检查失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// peephole 规则检查：每条规则至少一个用例，分别在关闭和开启优化时翻译同一段 VM 代码，
+// 确认规则确实命中、生成的指令更少，并在 Hack CPU 模拟器上从相同的随机初始内存运行两份机器码，
+// 比较结束时的内存（R13-R15 和栈顶以上的位置除外）。
+// 每个用例再在 --tos-cache 下检查一遍：合并命令在栈顶缓存在 D 中时走另一条代码路径，
+// 两种模式的结果都与不缓存、不优化的代码比较。
+// cd "project/08 - VM II_Program Control/code/src"
+// make test-peephole
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Equivalence.h"
+#include "Peephole.h"
+
+struct RuleCase {
+    const char* rule;
+    const char* source;
+};
+
+static const RuleCase CASES[] = {
+    {"fold-binary", "push constant 7\npush constant 9\nadd\npop local 0\n"},
+    {"fold-binary", "push constant 7\npush constant 9\nsub\npop local 0\n"},
+    {"fold-binary", "push constant 12\npush constant 10\nand\npush constant 12\npush constant 3\nor\npop temp 0\npop temp 1\n"},
+    {"fold-binary", "push constant 32767\npush constant 1\nadd\npop static 0\n"},
+    {"fold-binary", "push constant 5\npush constant 5\neq\npush constant 5\npush constant 6\neq\npop temp 0\npop temp 1\n"},
+    {"fold-binary", "push constant 9\npush constant 2\ngt\npush constant 2\npush constant 9\ngt\npop temp 0\npop temp 1\n"},
+    {"fold-binary", "push constant 2\npush constant 9\nlt\npush constant 9\npush constant 2\nlt\npop temp 0\npop temp 1\n"},
+    {"fold-binary", "push constant 4\npush constant 4\ngt\npush constant 4\npush constant 4\nlt\npop temp 0\npop temp 1\n"},
+    {"fold-binary", "push constant 20000\nneg\npush constant 20000\ngt\npop temp 2\n"},  // x-y 溢出
+    {"fold-unary",  "push constant 0\nnot\npop static 1\n"},
+    {"fold-unary",  "push constant 17\nneg\npop argument 3\n"},
+    {"fold-unary",  "push constant 32767\nnot\npop that 0\n"},  // -32768
+    {"fold-branch", "push constant 0\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"fold-branch", "push constant 3\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-branch", "push local 0\npush local 1\nlt\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-branch", "push local 0\npush local 1\ngt\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-branch", "push local 0\npush local 0\neq\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-branch", "push local 0\npush local 1\neq\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-branch", "gt\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},  // 两个操作数都在栈上
+    {"compare-not-branch", "push local 0\npush local 1\nlt\nnot\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-not-branch", "push local 0\npush local 0\ngt\nnot\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-not-branch", "push local 0\npush local 0\nlt\nnot\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"compare-not-branch", "push argument 0\npush argument 1\neq\nnot\nif-goto SKIP\npush constant 1\npop temp 0\nlabel SKIP\n"},
+    {"add-constant", "push local 0\npush constant 5\nadd\npop local 1\n"},
+    {"add-constant", "push local 0\npush constant 5\nsub\npop local 1\n"},
+    {"add-constant", "push argument 1\npush constant 1\nadd\npush argument 2\npush constant 1\nsub\npop temp 0\npop temp 1\n"},
+    {"add-constant", "push static 3\npush constant 0\nadd\npop static 4\n"},
+    {"self-move",   "push local 2\npop local 2\npush this 0\npop this 0\n"},
+    {"move",        "push local 0\npop local 1\npush argument 0\npop local 4\n"},
+    {"move",        "push this 3\npop that 5\npush that 1\npop this 0\n"},
+    {"move",        "push static 0\npop temp 3\npush temp 3\npop static 2\n"},
+    {"move",        "push pointer 0\npop pointer 1\npush that 0\npop pointer 0\npush this 2\npop local 0\n"},
+    {"move",        "push constant 0\npop local 0\npush constant 1\npop local 1\npush constant 1000\npop local 2\n"},
+    {"store",       "pop local 3\npush local 3\npop this 1\npush this 1\n"},
+    {"store",       "pop temp 0\npush temp 0\npop static 5\npush static 5\npop pointer 1\npush pointer 1\n"},
+    {"involution",  "push local 0\nnot\nnot\npop local 1\npush local 2\nneg\nneg\npop local 3\n"},
+};
+
+// 关闭 peephole 时 optimizer 为空
+static std::vector<uint16_t> translate(const char* source, bool tosCache, Peephole* optimizer) {
+    CodeGenOptions options;
+    options.tosCache = tosCache;
+    if (optimizer == nullptr) {
+        return translate(source, options);
+    }
+    return translate(source, options, [optimizer](std::vector<VMCommand>& commands, VMSymbols&) {
+        commands = optimizer->optimize(commands);
+    });
+}
+
+// 检查一个用例，返回发现的问题，空串表示通过
+static std::string checkCase(const RuleCase& check, size_t rule, bool tosCache) {
+    Peephole optimizer;
+    std::vector<uint16_t> reference = translate(check.source, false, nullptr);
+    std::vector<uint16_t> plain = translate(check.source, tosCache, nullptr);
+    std::vector<uint16_t> optimized = translate(check.source, tosCache, &optimizer);
+
+    std::string problem;
+    if (rule == Peephole::rules().size()) {
+        problem = "没有这条规则";
+    } else if (optimizer.hits()[rule] == 0) {
+        problem = "规则没有命中";
+    } else if (tosCache ? optimized.size() > plain.size() : optimized.size() >= plain.size()) {
+        // 栈顶缓存时 push / pop 已经只是装入和写出 D，move 这类规则不一定更短，但不能更长
+        problem = tosCache ? "指令反而增加" : "指令没有减少";
+    }
+    Comparison before;
+    Comparison after;
+    if (problem.empty()) {
+        before = compareRuns(reference, plain);
+        problem = before.problem;
+    }
+    if (problem.empty()) {
+        after = compareRuns(reference, optimized);
+        problem = after.problem;
+    }
+
+    std::cout << (problem.empty() ? "PASS " : "FAIL ") << check.rule << (tosCache ? " (tos-cache)" : "")
+              << ": ROM " << plain.size() << " -> " << optimized.size() << "，周期 " << before.actualCycles << " -> "
+              << after.actualCycles;
+    if (!problem.empty()) {
+        std::cout << "  " << problem;
+    }
+    std::cout << std::endl;
+    return problem;
+}
+
+int main() {
+    const std::vector<Peephole::Rule>& rules = Peephole::rules();
+    int failures = 0;
+
+    for (bool tosCache : {false, true}) {
+        std::vector<bool> covered(rules.size(), false);
+        for (const RuleCase& check : CASES) {
+            size_t rule = 0;
+            while (rule < rules.size() && std::strcmp(rules[rule].name, check.rule) != 0) rule++;
+            if (!checkCase(check, rule, tosCache).empty()) {
+                failures++;
+            } else if (rule < rules.size()) {
+                covered[rule] = true;
+            }
+        }
+        for (size_t rule = 0; rule < rules.size(); rule++) {
+            if (!covered[rule]) {
+                std::cout << "FAIL " << rules[rule].name << (tosCache ? " (tos-cache)" : "") << ": 没有通过的用例"
+                          << std::endl;
+                failures++;
+            }
+        }
+    }
+    std::cout << (failures == 0 ? "全部规则检查通过" : std::to_string(failures) + " 项检查失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
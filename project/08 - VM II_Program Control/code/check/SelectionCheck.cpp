@@ -0,0 +1,139 @@
+// 指令选择检查：对候选表中的每个序列，在它适用的每种段和下标上单独生成机器码，
+// 确认指令数等于表中的 cost，并在 Hack CPU 模拟器上从随机的内存和 D 出发运行，
+// 与按 VM 语义直接计算的结果比较（sameState 比较的内存，load / store 还比较 D）。
+// cd "project/08 - VM II_Program Control/code/src"
+// make test-selection
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Equivalence.h"
+
+struct Target {
+    Segment segment;
+    std::vector<int> indexes;
+};
+
+static const std::vector<Target>& targets() {
+    static const std::vector<int> OFFSETS = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 100};
+    static const std::vector<Target> TARGETS = {
+        // 合并命令中的常量可能是负数
+        {Segment::CONSTANT, {0, 1, -1, 2, 7, 255, 32767, -2, -17, -32768}},
+        {Segment::LOCAL, OFFSETS},
+        {Segment::ARGUMENT, OFFSETS},
+        {Segment::THIS, OFFSETS},
+        {Segment::THAT, OFFSETS},
+        {Segment::TEMP, {0, 1, 7}},
+        {Segment::POINTER, {0, 1}},
+        {Segment::STATIC, {0, 5}},
+    };
+    return TARGETS;
+}
+
+// 元素的地址：static 变量是程序中唯一的符号，汇编器把它分配到 RAM[16]
+static int addressOf(const HackCPU& cpu, Segment segment, int index) {
+    switch (segment) {
+        case Segment::LOCAL:    return cpu.ram[1] + index;
+        case Segment::ARGUMENT: return cpu.ram[2] + index;
+        case Segment::THIS:     return cpu.ram[3] + index;
+        case Segment::THAT:     return cpu.ram[4] + index;
+        case Segment::TEMP:     return 5 + index;
+        case Segment::POINTER:  return 3 + index;
+        default:                return 16;
+    }
+}
+
+// 按 VM 语义执行一次访问
+static void reference(HackCPU& cpu, Access access, Segment segment, int index) {
+    int16_t value = segment == Segment::CONSTANT ? static_cast<int16_t>(index)
+                                                 : cpu.ram[addressOf(cpu, segment, index)];
+    switch (access) {
+        case Access::PUSH:
+            cpu.ram[cpu.ram[0]] = value;
+            cpu.ram[0]++;
+            break;
+        case Access::POP: {
+            cpu.ram[0]--;
+            int16_t top = cpu.ram[cpu.ram[0]];
+            cpu.ram[addressOf(cpu, segment, index)] = top;
+            break;
+        }
+        case Access::LOAD:
+            cpu.d = value;
+            break;
+        case Access::STORE:
+            cpu.ram[addressOf(cpu, segment, index)] = cpu.d;
+            break;
+    }
+}
+
+static std::string run(const AccessPattern& pattern, Segment segment, int index, int cost) {
+    CodeWriter writer("/dev/null");
+    writer.setFileName("Check.vm");
+    pattern.emit(writer, segment, index);
+    std::vector<uint16_t> words = machineCode(writer);
+    if (static_cast<int>(words.size()) != cost) {
+        return "指令数 " + std::to_string(words.size()) + "，cost 为 " + std::to_string(cost);
+    }
+    return forEachSeed([&](uint64_t seed) -> std::string {
+        HackCPU expected;
+        randomize(expected, seed);
+        uint64_t state = seed;
+        expected.d = static_cast<int16_t>(nextRandom(state));
+        HackCPU actual = expected;
+        actual.rom = words;
+        reference(expected, pattern.access, segment, index);
+        if (!actual.run(1000)) {
+            return "程序没有结束";
+        }
+        std::string difference;
+        if (!sameState(expected, actual, difference)) {
+            return difference;
+        }
+        bool keepsD = pattern.access == Access::LOAD || pattern.access == Access::STORE;
+        if (keepsD && expected.d != actual.d) {
+            return "D 应为 " + std::to_string(expected.d) + "，实际为 " + std::to_string(actual.d);
+        }
+        return "";
+    });
+}
+
+int main() {
+    int failures = 0;
+    for (const AccessPattern& pattern : CodeWriter::accessPatterns()) {
+        size_t cases = 0;
+        size_t selected = 0;
+        std::string problem;
+        for (const Target& target : targets()) {
+            for (int index : target.indexes) {
+                int cost = pattern.cost(target.segment, index);
+                if (cost < 0 || !problem.empty()) continue;
+                cases++;
+                problem = run(pattern, target.segment, index, cost);
+                const AccessPattern* best = CodeWriter::selectPattern(pattern.access, target.segment, index);
+                if (problem.empty() && best->cost(target.segment, index) > cost) {
+                    problem = "选中了更长的 " + std::string(best->name);
+                }
+                if (best == &pattern) {
+                    selected++;
+                }
+                if (!problem.empty()) {
+                    problem += "（" + std::string(segmentName(target.segment)) + " " + std::to_string(index) + "）";
+                }
+            }
+        }
+        if (cases == 0) {
+            problem = "没有适用的用例";
+        }
+        std::cout << (problem.empty() ? "PASS " : "FAIL ") << pattern.name << ": " << cases << " 个用例，其中 "
+                  << selected << " 个被选中";
+        if (!problem.empty()) {
+            std::cout << "  " << problem;
+            failures++;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << (failures == 0 ? "全部指令选择检查通过" : std::to_string(failures) + " 项检查失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
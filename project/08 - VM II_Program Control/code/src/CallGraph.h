@@ -0,0 +1,113 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Parser.h"
+
+// 整个程序的调用图：目录模式下所有 .vm 文件解码完成后，从 Sys.init 出发沿 call 找出可达的函数，
+// 删除其余函数（多数是程序没有用到的 OS 例程）。
+// VM 语言只有按名字的直接调用，没有函数指针，所以 call 的目标就是全部的调用边。
+// 保守处理：同名函数的每一份定义都算可达；文件中第一个 function 之前的命令不属于任何函数，总是保留；
+// 入口函数不存在时不删除任何函数。
+class CallGraph {
+public:
+    struct Function {
+        uint32_t name;
+        size_t file;
+        size_t begin; // 在该文件命令列表中的范围 [begin, end)
+        size_t end;
+        std::vector<uint32_t> callees;
+        bool live = false;
+    };
+
+    explicit CallGraph(const std::vector<std::vector<VMCommand>>& files) {
+        for (size_t file = 0; file < files.size(); file++) {
+            const std::vector<VMCommand>& commands = files[file];
+            for (size_t i = 0; i < commands.size(); i++) {
+                if (commands[i].opcode == Opcode::FUNCTION) {
+                    if (!functions.empty() && functions.back().file == file) {
+                        functions.back().end = i;
+                    }
+                    functions.push_back({commands[i].symbol, file, i, commands.size(), {}});
+                } else if (commands[i].opcode == Opcode::CALL && !functions.empty() && functions.back().file == file) {
+                    functions.back().callees.push_back(commands[i].symbol);
+                }
+            }
+        }
+    }
+
+    // 从 entry 出发标记可达函数。entry 没有定义时返回 false，所有函数都视为可达。
+    // 被调用但没有任何定义的名字记录在 unresolved 中
+    bool markReachable(uint32_t entry, std::vector<uint32_t>& unresolved) {
+        std::vector<std::vector<size_t>> definitions;
+        for (size_t i = 0; i < functions.size(); i++) {
+            if (functions[i].name >= definitions.size()) definitions.resize(functions[i].name + 1);
+            definitions[functions[i].name].push_back(i);
+        }
+        auto definitionsOf = [&](uint32_t name) -> const std::vector<size_t>* {
+            return (name < definitions.size() && !definitions[name].empty()) ? &definitions[name] : nullptr;
+        };
+
+        if (definitionsOf(entry) == nullptr) {
+            for (Function& function : functions) function.live = true;
+            return false;
+        }
+        std::vector<bool> seen(definitions.size(), false);
+        std::vector<uint32_t> pending = {entry};
+        seen[entry] = true;
+        while (!pending.empty()) {
+            uint32_t name = pending.back();
+            pending.pop_back();
+            for (size_t index : *definitionsOf(name)) {
+                functions[index].live = true;
+                for (uint32_t callee : functions[index].callees) {
+                    if (callee >= seen.size()) seen.resize(callee + 1, false);
+                    if (seen[callee]) continue;
+                    seen[callee] = true;
+                    if (definitionsOf(callee) == nullptr) {
+                        unresolved.push_back(callee);
+                    } else {
+                        pending.push_back(callee);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // 删除不可达函数的命令，返回被删除的函数
+    std::vector<Function> removeDead(std::vector<std::vector<VMCommand>>& files) const {
+        std::vector<Function> removed;
+        std::vector<std::vector<bool>> dead(files.size());
+        for (size_t file = 0; file < files.size(); file++) {
+            dead[file].assign(files[file].size(), false);
+        }
+        for (const Function& function : functions) {
+            if (function.live) continue;
+            removed.push_back(function);
+            for (size_t i = function.begin; i < function.end; i++) {
+                dead[function.file][i] = true;
+            }
+        }
+        for (size_t file = 0; file < files.size(); file++) {
+            std::vector<VMCommand> kept;
+            kept.reserve(files[file].size());
+            for (size_t i = 0; i < files[file].size(); i++) {
+                if (!dead[file][i]) kept.push_back(files[file][i]);
+            }
+            files[file].swap(kept);
+        }
+        return removed;
+    }
+
+    const std::vector<Function>& all() const {
+        return functions;
+    }
+
+private:
+    std::vector<Function> functions;
+};
+
+#endif
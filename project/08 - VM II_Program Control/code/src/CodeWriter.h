@@ -1,20 +1,102 @@
 #ifndef CODEWRITER_H
 #define CODEWRITER_H
 
-#include <string>
 #include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "HackIR.h"
+#include "Parser.h"
+
+// 输出格式：asm 为汇编文本，hack 为直接解析标签后的机器码（与汇编器的 .hack 输出相同）
+enum class EmitFormat {
+    ASM,
+    HACK
+};
 
+// eq/gt/lt 的生成方式：inline 每次就地展开（约 17 条指令，最快），
+// shared 只在启动代码中生成一份比较例程，每次使用编译成 6 条指令的调用（返回地址放在 R13）
+enum class CompareMode {
+    INLINE,
+    SHARED
+};
+
+// call/return 的生成方式：inline 每次就地展开（call 约 45 条、return 约 40 条指令），
+// shared 只生成一份 __VM_CALL / __VM_RETURN 例程，调用处只需传入参数个数、目标和返回地址
+enum class CallMode {
+    INLINE,
+    SHARED
+};
+
+// 代码生成选项，决定 ROM 大小与执行速度之间的取舍
+struct CodeGenOptions {
+    CompareMode compare = CompareMode::INLINE;
+    CallMode call = CallMode::INLINE;
+    bool controlFlow = false; // 代码生成前先做函数级的控制流优化，见 ControlFlow.h
+    bool peephole = false; // 代码生成前先做 VM 级 peephole 优化，见 Peephole.h
+    bool tosCache = false; // 在基本块内把栈顶缓存在 D 中，见 CodeWriter::topInD
+
+    bool needsRuntime() const {
+        return compare == CompareMode::SHARED || call == CallMode::SHARED;
+    }
+};
+
+// 段访问的四种操作：push / pop 经过栈，load / store 经过 D（栈顶缓存和合并命令使用，store 保持 D 不变）
+enum class Access : uint8_t {
+    PUSH,
+    POP,
+    LOAD,
+    STORE
+};
+
+class CodeWriter;
+
+// 指令选择的一个候选序列：cost 按段和下标给出指令数，不适用时为 -1。
+// 序列都是直线代码，指令数也就是执行的周期数
+struct AccessPattern {
+    const char* name;
+    Access access;
+    int (*cost)(Segment segment, int index);
+    void (*emit)(CodeWriter& writer, Segment segment, int index);
+};
+
+// 代码生成器：各 write* 函数把指令追加到内存中的 HackProgram，close() 时一次性写出
 class CodeWriter {
 private:
-    std::ofstream outFile;
-    std::string currentFileName;
+    std::string outputFile;
+    EmitFormat format;
+    CodeGenOptions options;
+    HackProgram program;
+    std::string currentFileName;      // static 变量的前缀
     std::string currentFunctionName;  // 当前函数名
     int labelCounter;  // 用于生成唯一标签
     int callCounter;   // 用于生成唯一的返回地址标签
+    bool runtimeWritten;  // 共享例程是否已经生成（或已安排在启动代码中生成）
+    // 栈顶缓存（--tos-cache）：为 true 时逻辑上的栈顶在 D 中，不在内存里，RAM[SP] 以下才是其余元素。
+    // 只在基本块内成立，标签、跳转、call、return、function 之前都先写回内存
+    bool topInD;
+    bool closed;
+
+    void a(int value) {
+        program.number(value);
+    }
+
+    void a(std::string_view symbol) {
+        program.symbol(symbol);
+    }
+
+    void c(std::string_view instruction) {
+        program.c(hack::encode(instruction));
+    }
+
+    void label(std::string_view name) {
+        program.label(name);
+    }
 
-    // 写入注释
+    // 写入注释：标明后面的指令来自哪条 VM 命令，汇编器据此生成 .hmap 调试映射
     void writeComment(const std::string& comment) {
-        outFile << "// " << comment << std::endl;
+        program.comment("vm: " + comment);
     }
 
     // 生成唯一标签
@@ -22,448 +104,980 @@ private:
         return base + std::to_string(labelCounter++);
     }
 
-public:
-    CodeWriter(const std::string& outputFile) {
-        outFile.open(outputFile);
-        labelCounter = 0;
-        callCounter = 0;
-        currentFunctionName = "";
+    // 共享比较例程：弹出 y、x，把 x-y 与 0 比较的结果写回栈顶，然后跳回 R13 中的返回地址。
+    // 先把结果写成 false，条件成立时再跳到公共的 __VM_CMP_TRUE 改成 true
+    void writeCompareRoutines() {
+        static const char* const NAMES[] = {"EQ", "GT", "LT"};
+        static const char* const JUMPS[] = {"D;JEQ", "D;JGT", "D;JLT"};
+        for (int i = 0; i < 3; i++) {
+            label(std::string("__VM_") + NAMES[i]);
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("D=M-D");
+            c("M=0");
+            a("__VM_CMP_TRUE");
+            c(JUMPS[i]);
+            a("R13");
+            c("A=M");
+            c("0;JMP");
+        }
+        label("__VM_CMP_TRUE");
+        a("SP");
+        c("A=M-1");
+        c("M=-1");
+        a("R13");
+        c("A=M");
+        c("0;JMP");
     }
 
-    ~CodeWriter() {
-        if (outFile.is_open()) {
-            outFile.close();
+    // 共享调用例程：D = 返回地址，R14 = 参数个数，R15 = 目标函数地址。
+    // 依次压入返回地址、LCL、ARG、THIS、THAT，然后 LCL = SP，ARG = SP - 5 - nArgs，跳到目标
+    void writeCallRoutine() {
+        label("__VM_CALL");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        for (const char* pointer : {"LCL", "ARG", "THIS", "THAT"}) {
+            a(pointer);
+            c("D=M");
+            a("SP");
+            c("AM=M+1");
+            c("M=D");
         }
+        a("SP");
+        c("MD=M+1");
+        a("LCL");
+        c("M=D");
+        a("R14");
+        c("D=D-M");
+        a(5);
+        c("D=D-A");
+        a("ARG");
+        c("M=D");
+        a("R15");
+        c("A=M");
+        c("0;JMP");
     }
 
-    void setFileName(const std::string& fileName) {
-        // 提取不带路径和扩展名的文件名
-        size_t lastSlash = fileName.find_last_of("/\\");
-        size_t lastDot = fileName.find_last_of('.');
+    // 共享返回例程：与就地展开的 return 相同
+    void writeReturnRoutine() {
+        label("__VM_RETURN");
+        writeReturnBody();
+    }
+
+    // 生成启用的全部共享例程
+    void writeRuntime() {
+        program.comment("Shared runtime routines");
+        if (options.compare == CompareMode::SHARED) {
+            writeCompareRoutines();
+        }
+        if (options.call == CallMode::SHARED) {
+            writeCallRoutine();
+            writeReturnRoutine();
+        }
+    }
+
+    // 没有启动代码（单文件翻译）时在第一次使用处生成共享例程，前面加一条跳转越过它们
+    void requireRuntime() {
+        if (runtimeWritten) {
+            return;
+        }
+        runtimeWritten = true;
+        std::string skipLabel = getUniqueLabel("RUNTIME_SKIP");
+        a(skipLabel);
+        c("0;JMP");
+        writeRuntime();
+        label(skipLabel);
+    }
+
+    // 调用共享比较例程：R13 = 返回地址，跳到 __VM_EQ / __VM_GT / __VM_LT
+    void writeCompareCall(const char* name) {
+        requireRuntime();
+        std::string returnLabel = getUniqueLabel("CMP_RET");
+        a(returnLabel);
+        c("D=A");
+        a("R13");
+        c("M=D");
+        a(std::string("__VM_") + name);
+        c("0;JMP");
+        label(returnLabel);
+    }
+
+    // return 的完整展开：恢复调用者的段指针并跳回返回地址
+    void writeReturnBody() {
+        // frame = LCL (R13 = frame)
+        a("LCL");
+        c("D=M");
+        a("R13");
+        c("M=D");
+        
+        // retAddr = *(frame - 5) (R14 = return address)
+        a(5);
+        c("A=D-A");
+        c("D=M");
+        a("R14");
+        c("M=D");
+        
+        // *ARG = pop()
+        a("SP");
+        c("AM=M-1");
+        c("D=M");
+        a("ARG");
+        c("A=M");
+        c("M=D");
+        
+        // SP = ARG + 1
+        a("ARG");
+        c("D=M+1");
+        a("SP");
+        c("M=D");
+        
+        // THAT = *(frame - 1)
+        a("R13");
+        c("AM=M-1");
+        c("D=M");
+        a("THAT");
+        c("M=D");
         
-        if (lastSlash == std::string::npos) lastSlash = 0;
-        else lastSlash++;
+        // THIS = *(frame - 2)
+        a("R13");
+        c("AM=M-1");
+        c("D=M");
+        a("THIS");
+        c("M=D");
+        
+        // ARG = *(frame - 3)
+        a("R13");
+        c("AM=M-1");
+        c("D=M");
+        a("ARG");
+        c("M=D");
         
-        if (lastDot == std::string::npos || lastDot < lastSlash) {
-            currentFileName = fileName.substr(lastSlash);
+        // LCL = *(frame - 4)
+        a("R13");
+        c("AM=M-1");
+        c("D=M");
+        a("LCL");
+        c("M=D");
+        
+        // goto retAddr
+        a("R14");
+        c("A=M");
+        c("0;JMP");
+    }
+
+    // D = value，value 是 16 位有符号数；负数由 peephole 的常量折叠产生，用 !A 得到
+    void loadConstant(int value) {
+        if (value >= 0) {
+            a(value);
+            c("D=A");
+        } else {
+            a(~value);
+            c("D=!A");
+        }
+    }
+
+    // 静态变量、temp、pointer 段的固定地址
+    void addressFixed(Segment segment, int index) {
+        if (segment == Segment::TEMP) {
+            a(5 + index);
+        } else if (segment == Segment::POINTER) {
+            a(index == 0 ? "THIS" : "THAT");
         } else {
-            currentFileName = fileName.substr(lastSlash, lastDot - lastSlash);
+            a(currentFileName + "." + std::to_string(index));
+        }
+    }
+
+    // D = 段 segment 的第 index 个元素（peephole 合并命令使用）
+    void loadSegment(Segment segment, int index) {
+        writeAccess(Access::LOAD, segment, index);
+    }
+
+    // 把 load 得到的 D 写入段 segment 的第 index 个元素（合并命令使用）。
+    // 选出的 store 序列比 "先算出地址存入 R13（6 条），取值后 @R13 A=M M=D" 更长时改用后者
+    template <typename Load>
+    void storeValue(Segment segment, int index, Load load) {
+        const AccessPattern* store = selectPattern(Access::STORE, segment, index);
+        if (store->cost(segment, index) <= 6 + 3) {
+            load();
+            store->emit(*this, segment, index);
+            return;
+        }
+        a(segmentPointer(segment));
+        c("D=M");
+        a(index);
+        c("D=D+A");
+        a("R13");
+        c("M=D");
+        load();
+        a("R13");
+        c("A=M");
+        c("M=D");
+    }
+
+    // 把缓存在 D 中的栈顶写回内存
+    void flush() {
+        if (topInD) {
+            a("SP");
+            c("AM=M+1");
+            c("A=A-1");
+            c("M=D");
+            topInD = false;
+        }
+    }
+
+    // 确保栈顶在 D 中：不在时弹出到 D
+    void popToD() {
+        if (!topInD) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            topInD = true;
+        }
+    }
+
+    // 把 D 写入段 segment 的第 index 个元素，D 保持不变
+    void storeD(Segment segment, int index) {
+        writeAccess(Access::STORE, segment, index);
+    }
+
+    // 把 A 指向 local/argument/this/that 段的第 index 个元素：A=M 或 A=M+1，再逐次加一，不改写 D
+    void addressOffset(Segment segment, int index) {
+        a(segmentPointer(segment));
+        c(index == 0 ? "A=M" : "A=M+1");
+        for (int i = 1; i < index; i++) {
+            c("A=A+1");
+        }
+    }
+
+    static int offsetCost(int index) {
+        return 2 + (index > 1 ? index - 1 : 0);
+    }
+
+    // 把 D 压栈
+    void pushD() {
+        a("SP");
+        c("AM=M+1");
+        c("A=A-1");
+        c("M=D");
+    }
+
+    // 弹出栈顶到 D
+    void popD() {
+        a("SP");
+        c("AM=M-1");
+        c("D=M");
+    }
+
+    static bool isSmallConstant(Segment segment, int index) {
+        return segment == Segment::CONSTANT && index >= -1 && index <= 1;
+    }
+
+    static bool isFixed(Segment segment) {
+        return segment == Segment::TEMP || segment == Segment::POINTER || segment == Segment::STATIC;
+    }
+
+    static bool isIndirect(Segment segment) {
+        return segmentPointer(segment) != nullptr;
+    }
+
+    // 按指令数选出最便宜的候选序列，指令数相同时取表中靠前的
+    void writeAccess(Access access, Segment segment, int index) {
+        selectPattern(access, segment, index)->emit(*this, segment, index);
+    }
+
+    // 栈顶缓存模式下的算术命令：二元运算和比较的结果留在 D 中
+    void writeCachedArithmetic(Opcode command) {
+        bool compare = command == Opcode::EQ || command == Opcode::GT || command == Opcode::LT;
+        if (compare && options.compare == CompareMode::SHARED) {
+            flush();
+            writeCompareCall(command == Opcode::EQ ? "EQ" : command == Opcode::GT ? "GT" : "LT");
+            return;
+        }
+        if (command == Opcode::NEG || command == Opcode::NOT) {
+            if (topInD) {
+                c(command == Opcode::NEG ? "D=-D" : "D=!D");
+            } else {
+                a("SP");
+                c("A=M-1");
+                c(command == Opcode::NEG ? "M=-M" : "M=!M");
+            }
+            return;
+        }
+
+        popToD();
+        a("SP");
+        c("AM=M-1");
+        switch (command) {
+            case Opcode::ADD: c("D=D+M"); return;
+            case Opcode::SUB: c("D=M-D"); return;
+            case Opcode::AND: c("D=D&M"); return;
+            case Opcode::OR:  c("D=D|M"); return;
+            default: break;
         }
+        const char* name = command == Opcode::EQ ? "EQ" : command == Opcode::GT ? "GT" : "LT";
+        std::string trueLabel = getUniqueLabel(std::string(name) + "_TRUE");
+        std::string endLabel = getUniqueLabel(std::string(name) + "_END");
+        c("D=M-D");
+        a(trueLabel);
+        c(command == Opcode::EQ ? "D;JEQ" : command == Opcode::GT ? "D;JGT" : "D;JLT");
+        c("D=0");
+        a(endLabel);
+        c("0;JMP");
+        label(trueLabel);
+        c("D=-1");
+        label(endLabel);
+    }
+
+    // 栈顶缓存模式下的 push/pop：push 把值装入 D，pop 直接写出 D
+    void writeCachedPushPop(Opcode command, Segment segment, int index) {
+        if (command == Opcode::PUSH) {
+            flush();
+            loadSegment(segment, index);
+            topInD = true;
+        } else {
+            popToD();
+            storeD(segment, index);
+            topInD = false;
+        }
+    }
+
+public:
+    CodeWriter(const std::string& outputFile, EmitFormat format = EmitFormat::ASM, CodeGenOptions options = {})
+        : outputFile(outputFile), format(format), options(options), labelCounter(0), callCounter(0),
+          runtimeWritten(false), topInD(false), closed(false) {
+        currentFunctionName = "";
+    }
+
+    void setFileName(const std::string& fileName) {
+        flush();
+        currentFileName = fileStem(fileName);
+    }
+
+    // 段基址指针：local/argument/this/that 对应 LCL/ARG/THIS/THAT，其余段为空
+    static const char* segmentPointer(Segment segment) {
+        switch (segment) {
+            case Segment::LOCAL:    return "LCL";
+            case Segment::ARGUMENT: return "ARG";
+            case Segment::THIS:     return "THIS";
+            case Segment::THAT:     return "THAT";
+            default:                return nullptr;
+        }
+    }
+
+    // 段访问的候选序列表。下标的分类体现在 cost 中：offset 序列的长度随下标增长，
+    // add / sum 序列长度固定，常量 -1、0、1 可以直接作为 comp
+    static const std::vector<AccessPattern>& accessPatterns() {
+        static const std::vector<AccessPattern> PATTERNS = {
+            // push：先得到值，再 @SP AM=M+1 A=A-1 M=D
+            {"push-constant-small", Access::PUSH,
+             [](Segment segment, int index) { return isSmallConstant(segment, index) ? 4 : -1; },
+             [](CodeWriter& w, Segment, int index) {
+                 w.a("SP");
+                 w.c("AM=M+1");
+                 w.c("A=A-1");
+                 w.c(index == 0 ? "M=0" : index == 1 ? "M=1" : "M=-1");
+             }},
+            {"push-constant", Access::PUSH,
+             [](Segment segment, int) { return segment == Segment::CONSTANT ? 6 : -1; },
+             [](CodeWriter& w, Segment, int index) {
+                 w.loadConstant(index);
+                 w.pushD();
+             }},
+            {"push-fixed", Access::PUSH,
+             [](Segment segment, int) { return isFixed(segment) ? 6 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressFixed(segment, index);
+                 w.c("D=M");
+                 w.pushD();
+             }},
+            {"push-indirect-offset", Access::PUSH,
+             [](Segment segment, int index) { return isIndirect(segment) ? offsetCost(index) + 5 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressOffset(segment, index);
+                 w.c("D=M");
+                 w.pushD();
+             }},
+            {"push-indirect-add", Access::PUSH,
+             [](Segment segment, int) { return isIndirect(segment) ? 9 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.a(segmentPointer(segment));
+                 w.c("D=M");
+                 w.a(index);
+                 w.c("A=D+A");
+                 w.c("D=M");
+                 w.pushD();
+             }},
+
+            // pop：@SP AM=M-1 D=M，再写入目标
+            {"pop-fixed", Access::POP,
+             [](Segment segment, int) { return isFixed(segment) ? 5 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.popD();
+                 w.addressFixed(segment, index);
+                 w.c("M=D");
+             }},
+            {"pop-indirect-offset", Access::POP,
+             [](Segment segment, int index) { return isIndirect(segment) ? offsetCost(index) + 4 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.popD();
+                 w.addressOffset(segment, index);
+                 w.c("M=D");
+             }},
+            // 地址与值相加后再分离：D = 地址 + 值，A = D - 值，M = D - A，不需要 R13
+            {"pop-indirect-sum", Access::POP,
+             [](Segment segment, int) { return isIndirect(segment) ? 9 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.a(segmentPointer(segment));
+                 w.c("D=M");
+                 w.a(index);
+                 w.c("D=D+A");
+                 w.a("SP");
+                 w.c("AM=M-1");
+                 w.c("D=D+M");
+                 w.c("A=D-M");
+                 w.c("M=D-A");
+             }},
+
+            // load：D = 值
+            {"load-constant-small", Access::LOAD,
+             [](Segment segment, int index) { return isSmallConstant(segment, index) ? 1 : -1; },
+             [](CodeWriter& w, Segment, int index) {
+                 w.c(index == 0 ? "D=0" : index == 1 ? "D=1" : "D=-1");
+             }},
+            {"load-constant", Access::LOAD,
+             [](Segment segment, int) { return segment == Segment::CONSTANT ? 2 : -1; },
+             [](CodeWriter& w, Segment, int index) {
+                 w.loadConstant(index);
+             }},
+            {"load-fixed", Access::LOAD,
+             [](Segment segment, int) { return isFixed(segment) ? 2 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressFixed(segment, index);
+                 w.c("D=M");
+             }},
+            {"load-indirect-offset", Access::LOAD,
+             [](Segment segment, int index) { return isIndirect(segment) ? offsetCost(index) + 1 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressOffset(segment, index);
+                 w.c("D=M");
+             }},
+            {"load-indirect-add", Access::LOAD,
+             [](Segment segment, int) { return isIndirect(segment) ? 5 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.a(segmentPointer(segment));
+                 w.c("D=M");
+                 w.a(index);
+                 w.c("A=D+A");
+                 w.c("D=M");
+             }},
+
+            // store：把 D 写入目标，D 保持不变
+            {"store-fixed", Access::STORE,
+             [](Segment segment, int) { return isFixed(segment) ? 2 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressFixed(segment, index);
+                 w.c("M=D");
+             }},
+            {"store-indirect-offset", Access::STORE,
+             [](Segment segment, int index) { return isIndirect(segment) ? offsetCost(index) + 1 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.addressOffset(segment, index);
+                 w.c("M=D");
+             }},
+            // 值先存入 R13，再用与 pop-indirect-sum 相同的方法分离地址，最后恢复 D
+            {"store-indirect-sum", Access::STORE,
+             [](Segment segment, int) { return isIndirect(segment) ? 11 : -1; },
+             [](CodeWriter& w, Segment segment, int index) {
+                 w.a("R13");
+                 w.c("M=D");
+                 w.a(segmentPointer(segment));
+                 w.c("D=M");
+                 w.a(index);
+                 w.c("D=D+A");
+                 w.a("R13");
+                 w.c("D=D+M");
+                 w.c("A=D-M");
+                 w.c("M=D-A");
+                 w.c("D=D-A");
+             }},
+        };
+        return PATTERNS;
+    }
+
+    // 操作 access 访问段 segment 第 index 个元素时指令最少的候选序列
+    static const AccessPattern* selectPattern(Access access, Segment segment, int index) {
+        const AccessPattern* best = nullptr;
+        int bestCost = 0;
+        for (const AccessPattern& pattern : accessPatterns()) {
+            if (pattern.access != access) continue;
+            int cost = pattern.cost(segment, index);
+            if (cost >= 0 && (best == nullptr || cost < bestCost)) {
+                best = &pattern;
+                bestCost = cost;
+            }
+        }
+        return best;
     }
 
     // 写入算术/逻辑命令
-    void writeArithmetic(const std::string& command) {
-        writeComment(command);
-
-        if (command == "add") {
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "M=D+M" << std::endl;
-        }
-        else if (command == "sub") {
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "M=M-D" << std::endl;
-        }
-        else if (command == "neg") {
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=-M" << std::endl;
-        }
-        else if (command == "eq") {
+    void writeArithmetic(Opcode command) {
+        writeComment(opcodeName(command));
+        if (options.tosCache) {
+            writeCachedArithmetic(command);
+            return;
+        }
+
+        if (options.compare == CompareMode::SHARED &&
+            (command == Opcode::EQ || command == Opcode::GT || command == Opcode::LT)) {
+            writeCompareCall(command == Opcode::EQ ? "EQ" : command == Opcode::GT ? "GT" : "LT");
+            return;
+        }
+
+        if (command == Opcode::ADD) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("M=D+M");
+        }
+        else if (command == Opcode::SUB) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("M=M-D");
+        }
+        else if (command == Opcode::NEG) {
+            a("SP");
+            c("A=M-1");
+            c("M=-M");
+        }
+        else if (command == Opcode::EQ) {
             std::string trueLabel = getUniqueLabel("EQ_TRUE");
             std::string endLabel = getUniqueLabel("EQ_END");
             
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "D=M-D" << std::endl;
-            outFile << "@" << trueLabel << std::endl;
-            outFile << "D;JEQ" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=0" << std::endl;
-            outFile << "@" << endLabel << std::endl;
-            outFile << "0;JMP" << std::endl;
-            outFile << "(" << trueLabel << ")" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=-1" << std::endl;
-            outFile << "(" << endLabel << ")" << std::endl;
-        }
-        else if (command == "gt") {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("D=M-D");
+            a(trueLabel);
+            c("D;JEQ");
+            a("SP");
+            c("A=M-1");
+            c("M=0");
+            a(endLabel);
+            c("0;JMP");
+            label(trueLabel);
+            a("SP");
+            c("A=M-1");
+            c("M=-1");
+            label(endLabel);
+        }
+        else if (command == Opcode::GT) {
             std::string trueLabel = getUniqueLabel("GT_TRUE");
             std::string endLabel = getUniqueLabel("GT_END");
             
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "D=M-D" << std::endl;
-            outFile << "@" << trueLabel << std::endl;
-            outFile << "D;JGT" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=0" << std::endl;
-            outFile << "@" << endLabel << std::endl;
-            outFile << "0;JMP" << std::endl;
-            outFile << "(" << trueLabel << ")" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=-1" << std::endl;
-            outFile << "(" << endLabel << ")" << std::endl;
-        }
-        else if (command == "lt") {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("D=M-D");
+            a(trueLabel);
+            c("D;JGT");
+            a("SP");
+            c("A=M-1");
+            c("M=0");
+            a(endLabel);
+            c("0;JMP");
+            label(trueLabel);
+            a("SP");
+            c("A=M-1");
+            c("M=-1");
+            label(endLabel);
+        }
+        else if (command == Opcode::LT) {
             std::string trueLabel = getUniqueLabel("LT_TRUE");
             std::string endLabel = getUniqueLabel("LT_END");
             
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "D=M-D" << std::endl;
-            outFile << "@" << trueLabel << std::endl;
-            outFile << "D;JLT" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=0" << std::endl;
-            outFile << "@" << endLabel << std::endl;
-            outFile << "0;JMP" << std::endl;
-            outFile << "(" << trueLabel << ")" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=-1" << std::endl;
-            outFile << "(" << endLabel << ")" << std::endl;
-        }
-        else if (command == "and") {
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "M=D&M" << std::endl;
-        }
-        else if (command == "or") {
-            outFile << "@SP" << std::endl;
-            outFile << "AM=M-1" << std::endl;
-            outFile << "D=M" << std::endl;
-            outFile << "A=A-1" << std::endl;
-            outFile << "M=D|M" << std::endl;
-        }
-        else if (command == "not") {
-            outFile << "@SP" << std::endl;
-            outFile << "A=M-1" << std::endl;
-            outFile << "M=!M" << std::endl;
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("D=M-D");
+            a(trueLabel);
+            c("D;JLT");
+            a("SP");
+            c("A=M-1");
+            c("M=0");
+            a(endLabel);
+            c("0;JMP");
+            label(trueLabel);
+            a("SP");
+            c("A=M-1");
+            c("M=-1");
+            label(endLabel);
+        }
+        else if (command == Opcode::AND) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("M=D&M");
+        }
+        else if (command == Opcode::OR) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+            c("A=A-1");
+            c("M=D|M");
+        }
+        else if (command == Opcode::NOT) {
+            a("SP");
+            c("A=M-1");
+            c("M=!M");
         }
     }
 
     // 写入 push/pop 命令
-    void writePushPop(const std::string& command, const std::string& segment, int index) {
-        writeComment(command + " " + segment + " " + std::to_string(index));
-
-        if (command == "push") {
-            if (segment == "constant") {
-                outFile << "@" << index << std::endl;
-                outFile << "D=A" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "M=M+1" << std::endl;
-            }
-            else if (segment == "local" || segment == "argument" || 
-                     segment == "this" || segment == "that") {
-                std::string segmentPointer;
-                if (segment == "local") segmentPointer = "LCL";
-                else if (segment == "argument") segmentPointer = "ARG";
-                else if (segment == "this") segmentPointer = "THIS";
-                else segmentPointer = "THAT";
-
-                outFile << "@" << segmentPointer << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@" << index << std::endl;
-                outFile << "A=D+A" << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "M=M+1" << std::endl;
-            }
-            else if (segment == "temp") {
-                outFile << "@" << (5 + index) << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "M=M+1" << std::endl;
-            }
-            else if (segment == "pointer") {
-                std::string pointer = (index == 0) ? "THIS" : "THAT";
-                outFile << "@" << pointer << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "M=M+1" << std::endl;
-            }
-            else if (segment == "static") {
-                outFile << "@" << currentFileName << "." << index << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "M=M+1" << std::endl;
-            }
-        }
-        else if (command == "pop") {
-            if (segment == "local" || segment == "argument" || 
-                segment == "this" || segment == "that") {
-                std::string segmentPointer;
-                if (segment == "local") segmentPointer = "LCL";
-                else if (segment == "argument") segmentPointer = "ARG";
-                else if (segment == "this") segmentPointer = "THIS";
-                else segmentPointer = "THAT";
-
-                outFile << "@" << segmentPointer << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@" << index << std::endl;
-                outFile << "D=D+A" << std::endl;
-                outFile << "@R13" << std::endl;
-                outFile << "M=D" << std::endl;
-                outFile << "@SP" << std::endl;
-                outFile << "AM=M-1" << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@R13" << std::endl;
-                outFile << "A=M" << std::endl;
-                outFile << "M=D" << std::endl;
-            }
-            else if (segment == "temp") {
-                outFile << "@SP" << std::endl;
-                outFile << "AM=M-1" << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@" << (5 + index) << std::endl;
-                outFile << "M=D" << std::endl;
-            }
-            else if (segment == "pointer") {
-                std::string pointer = (index == 0) ? "THIS" : "THAT";
-                outFile << "@SP" << std::endl;
-                outFile << "AM=M-1" << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@" << pointer << std::endl;
-                outFile << "M=D" << std::endl;
-            }
-            else if (segment == "static") {
-                outFile << "@SP" << std::endl;
-                outFile << "AM=M-1" << std::endl;
-                outFile << "D=M" << std::endl;
-                outFile << "@" << currentFileName << "." << index << std::endl;
-                outFile << "M=D" << std::endl;
-            }
+    void writePushPop(Opcode command, Segment segment, int index) {
+        writeComment(std::string(opcodeName(command)) + " " + segmentName(segment) + " " + std::to_string(index));
+        if (options.tosCache) {
+            writeCachedPushPop(command, segment, index);
+            return;
         }
+
+        writeAccess(command == Opcode::PUSH ? Access::PUSH : Access::POP, segment, index);
     }
 
     // 写入初始化代码（启动代码）
     void writeInit() {
-        writeComment("Bootstrap code");
+        program.comment("Bootstrap code");
         // 初始化 SP = 256
-        outFile << "@256" << std::endl;
-        outFile << "D=A" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=D" << std::endl;
-        // 调用 Sys.init
+        a(256);
+        c("D=A");
+        a("SP");
+        c("M=D");
+        // 调用 Sys.init；Sys.init 不会返回，共享例程紧跟在调用之后生成，调用本身也可以使用它们
+        runtimeWritten = true;
         writeCall("Sys.init", 0);
+        if (options.needsRuntime()) {
+            writeRuntime();
+        }
+    }
+
+    // 写入 peephole 合并出的 push S i / pop T j：直接在内存之间复制
+    void writeMove(Segment source, int sourceIndex, Segment target, int targetIndex) {
+        writeComment(std::string("push ") + segmentName(source) + " " + std::to_string(sourceIndex) +
+                     " / pop " + segmentName(target) + " " + std::to_string(targetIndex));
+        flush();
+        storeValue(target, targetIndex, [&] { loadSegment(source, sourceIndex); });
+    }
+
+    // 写入 peephole 合并出的 pop S i / push S i：把栈顶写入 S i，但不弹出
+    void writeStore(Segment segment, int index) {
+        std::string operand = std::string(segmentName(segment)) + " " + std::to_string(index);
+        writeComment("pop " + operand + " / push " + operand);
+        if (options.tosCache) {
+            popToD();
+            storeD(segment, index);
+            return;
+        }
+        storeValue(segment, index, [this] {
+            a("SP");
+            c("A=M-1");
+            c("D=M");
+        });
+    }
+
+    // 写入 peephole 合并出的 push constant k / add：栈顶直接加上 k
+    void writeAddConstant(int value) {
+        writeComment("add-constant " + std::to_string(value));
+        if (topInD) {
+            if (value == 1 || value == -1) {
+                c(value == 1 ? "D=D+1" : "D=D-1");
+            } else if (value > 0) {
+                a(value);
+                c("D=D+A");
+            } else if (value != -32768) {
+                a(-value);
+                c("D=D-A");
+            } else {
+                a(32767);
+                c("D=D+A");
+                c("D=D+1");
+            }
+            return;
+        }
+        if (value == 1 || value == -1) {
+            a("SP");
+            c("A=M-1");
+            c(value == 1 ? "M=M+1" : "M=M-1");
+            return;
+        }
+        if (value < 0 && value != -32768) {
+            a(-value);
+            c("D=A");
+            a("SP");
+            c("A=M-1");
+            c("M=M-D");
+            return;
+        }
+        loadConstant(value);
+        a("SP");
+        c("A=M-1");
+        c("M=D+M");
+    }
+
+    // 写入 peephole 合并出的比较与 if-goto：弹出 y、x，计算 x-y 后直接条件跳转。
+    // 与 eq/gt/lt 一样按 16 位的 x-y 判断，结果相同，但不生成布尔值，也不需要两个内部标签
+    void writeCompareGoto(Opcode condition, const std::string& label) {
+        static const char* const JUMPS[] = {"D;JEQ", "D;JNE", "D;JGT", "D;JLE", "D;JLT", "D;JGE"};
+        writeComment(std::string(opcodeName(condition)) + " " + label);
+        if (!topInD) {
+            a("SP");
+            c("AM=M-1");
+            c("D=M");
+        }
+        topInD = false;
+        a("SP");
+        c("AM=M-1");
+        c("D=M-D");
+        a(currentFunctionName + "$" + label);
+        c(JUMPS[static_cast<int>(condition) - static_cast<int>(Opcode::IF_EQ)]);
+    }
+
+    // 按操作码分派一条已解码的命令
+    void writeCommand(const VMCommand& command, const VMSymbols& symbols) {
+        // static 命令带有所属的文件，内联进其他文件的函数后仍然访问原来文件的 static 变量
+        if (command.segment == Segment::STATIC || command.targetSegment == Segment::STATIC) {
+            currentFileName = symbols.name(command.symbol);
+        }
+        switch (commandType(command.opcode)) {
+            case C_ARITHMETIC:
+                writeArithmetic(command.opcode);
+                break;
+            case C_PUSH:
+            case C_POP:
+                writePushPop(command.opcode, command.segment, command.index);
+                break;
+            case C_LABEL:
+                writeLabel(symbols.name(command.symbol));
+                break;
+            case C_GOTO:
+                writeGoto(symbols.name(command.symbol));
+                break;
+            case C_IF:
+                writeIf(symbols.name(command.symbol));
+                break;
+            case C_FUNCTION:
+                writeFunction(symbols.name(command.symbol), command.index);
+                break;
+            case C_CALL:
+                writeCall(symbols.name(command.symbol), command.index);
+                break;
+            case C_RETURN:
+                writeReturn();
+                break;
+            case C_FUSED:
+                if (command.opcode == Opcode::MOVE) {
+                    writeMove(command.segment, command.index, command.targetSegment, command.targetIndex);
+                } else if (command.opcode == Opcode::STORE) {
+                    writeStore(command.segment, command.index);
+                } else if (command.opcode == Opcode::ADD_CONSTANT) {
+                    writeAddConstant(command.index);
+                } else {
+                    writeCompareGoto(command.opcode, symbols.name(command.symbol));
+                }
+                break;
+        }
+    }
+
+    // 已生成的指令
+    const HackProgram& code() const {
+        return program;
     }
 
     // 写入 label 命令
     void writeLabel(const std::string& label) {
         writeComment("label " + label);
-        outFile << "(" << currentFunctionName << "$" << label << ")" << std::endl;
+        flush();
+        this->label(currentFunctionName + "$" + label);
     }
 
     // 写入 goto 命令
     void writeGoto(const std::string& label) {
         writeComment("goto " + label);
-        outFile << "@" << currentFunctionName << "$" << label << std::endl;
-        outFile << "0;JMP" << std::endl;
+        flush();
+        a(currentFunctionName + "$" + label);
+        c("0;JMP");
     }
 
     // 写入 if-goto 命令
     void writeIf(const std::string& label) {
         writeComment("if-goto " + label);
-        outFile << "@SP" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@" << currentFunctionName << "$" << label << std::endl;
-        outFile << "D;JNE" << std::endl;
+        if (topInD) {
+            topInD = false;
+            a(currentFunctionName + "$" + label);
+            c("D;JNE");
+            return;
+        }
+        a("SP");
+        c("AM=M-1");
+        c("D=M");
+        a(currentFunctionName + "$" + label);
+        c("D;JNE");
     }
 
     // 写入 function 命令
     void writeFunction(const std::string& functionName, int nVars) {
         writeComment("function " + functionName + " " + std::to_string(nVars));
+        flush();
         currentFunctionName = functionName;
         
         // 声明函数入口标签
-        outFile << "(" << functionName << ")" << std::endl;
+        label(functionName);
         
         // 初始化局部变量为 0
         for (int i = 0; i < nVars; i++) {
-            outFile << "@SP" << std::endl;
-            outFile << "A=M" << std::endl;
-            outFile << "M=0" << std::endl;
-            outFile << "@SP" << std::endl;
-            outFile << "M=M+1" << std::endl;
+            writeAccess(Access::PUSH, Segment::CONSTANT, 0);
         }
     }
 
     // 写入 call 命令
     void writeCall(const std::string& functionName, int nArgs) {
         writeComment("call " + functionName + " " + std::to_string(nArgs));
+        flush();
         std::string returnLabel = "RETURN_" + std::to_string(callCounter++);
-        
+
+        if (options.call == CallMode::SHARED) {
+            requireRuntime();
+            a(nArgs);
+            c("D=A");
+            a("R14");
+            c("M=D");
+            a(functionName);
+            c("D=A");
+            a("R15");
+            c("M=D");
+            a(returnLabel);
+            c("D=A");
+            a("__VM_CALL");
+            c("0;JMP");
+            label(returnLabel);
+            return;
+        }
+
         // push return-address
-        outFile << "@" << returnLabel << std::endl;
-        outFile << "D=A" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=M+1" << std::endl;
+        a(returnLabel);
+        c("D=A");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        a("SP");
+        c("M=M+1");
         
         // push LCL
-        outFile << "@LCL" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=M+1" << std::endl;
+        a("LCL");
+        c("D=M");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        a("SP");
+        c("M=M+1");
         
         // push ARG
-        outFile << "@ARG" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=M+1" << std::endl;
+        a("ARG");
+        c("D=M");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        a("SP");
+        c("M=M+1");
         
         // push THIS
-        outFile << "@THIS" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=M+1" << std::endl;
+        a("THIS");
+        c("D=M");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        a("SP");
+        c("M=M+1");
         
         // push THAT
-        outFile << "@THAT" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=M+1" << std::endl;
+        a("THAT");
+        c("D=M");
+        a("SP");
+        c("A=M");
+        c("M=D");
+        a("SP");
+        c("M=M+1");
         
         // ARG = SP - 5 - nArgs
-        outFile << "@SP" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@" << (5 + nArgs) << std::endl;
-        outFile << "D=D-A" << std::endl;
-        outFile << "@ARG" << std::endl;
-        outFile << "M=D" << std::endl;
+        a("SP");
+        c("D=M");
+        a(5 + nArgs);
+        c("D=D-A");
+        a("ARG");
+        c("M=D");
         
         // LCL = SP
-        outFile << "@SP" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@LCL" << std::endl;
-        outFile << "M=D" << std::endl;
+        a("SP");
+        c("D=M");
+        a("LCL");
+        c("M=D");
         
         // goto functionName
-        outFile << "@" << functionName << std::endl;
-        outFile << "0;JMP" << std::endl;
+        a(functionName);
+        c("0;JMP");
         
         // (return-address)
-        outFile << "(" << returnLabel << ")" << std::endl;
+        label(returnLabel);
     }
 
     // 写入 return 命令
     void writeReturn() {
         writeComment("return");
-        
-        // frame = LCL (R13 = frame)
-        outFile << "@LCL" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@R13" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // retAddr = *(frame - 5) (R14 = return address)
-        outFile << "@5" << std::endl;
-        outFile << "A=D-A" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@R14" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // *ARG = pop()
-        outFile << "@SP" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@ARG" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // SP = ARG + 1
-        outFile << "@ARG" << std::endl;
-        outFile << "D=M+1" << std::endl;
-        outFile << "@SP" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // THAT = *(frame - 1)
-        outFile << "@R13" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@THAT" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // THIS = *(frame - 2)
-        outFile << "@R13" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@THIS" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // ARG = *(frame - 3)
-        outFile << "@R13" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@ARG" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // LCL = *(frame - 4)
-        outFile << "@R13" << std::endl;
-        outFile << "AM=M-1" << std::endl;
-        outFile << "D=M" << std::endl;
-        outFile << "@LCL" << std::endl;
-        outFile << "M=D" << std::endl;
-        
-        // goto retAddr
-        outFile << "@R14" << std::endl;
-        outFile << "A=M" << std::endl;
-        outFile << "0;JMP" << std::endl;
+        flush();
+        if (options.call == CallMode::SHARED) {
+            requireRuntime();
+            a("__VM_RETURN");
+            c("0;JMP");
+            return;
+        }
+        writeReturnBody();
     }
 
-    void close() {
-        if (outFile.is_open()) {
-            outFile.close();
+    // 写出输出文件，失败（无法打开文件、机器码超出 32K ROM）时返回 false
+    bool close() {
+        if (closed) {
+            return true;
+        }
+        closed = true;
+        flush();
+
+        std::string text;
+        if (format == EmitFormat::HACK) {
+            std::vector<uint16_t> words;
+            std::string error;
+            if (!program.toMachineCode(words, error)) {
+                std::cerr << "错误: " << error << std::endl;
+                return false;
+            }
+            text = HackProgram::formatHack(words);
+        } else {
+            text = program.toAssembly();
+        }
+
+        std::ofstream outFile(outputFile, std::ios::binary);
+        if (!outFile.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+            std::cerr << "无法写入输出文件: " << outputFile << std::endl;
+            return false;
         }
+        return true;
     }
 };
 
@@ -0,0 +1,335 @@
+#ifndef CONTROLFLOW_H
+#define CONTROLFLOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Parser.h"
+
+// 函数级的控制流优化：把每个函数切成基本块，在块之间做以下变换后再按原来的顺序写回命令流。
+//   - 跳转穿透：跳到 "只有一条 goto" 或空块的标签时，直接跳到最终目标
+//   - 跳到紧随其后的块的 goto 删除
+//   - if-goto L1 / goto L2 / label L1 改为按相反条件 if-goto L2（Jack 的 if 语句）
+//   - 循环旋转：goto 回到 "条件 + if-goto 出口" 的循环头时，把条件复制到循环末尾并反转，
+//     每次迭代少执行一条 goto 和一个 not（Jack 的 while 语句）
+//   - 删除不可达的块和没有跳转引用的标签
+// 条件只在能精确反转时才反转：栈顶是比较的结果（-1 或 0）时在后面加 not，是比较结果再取 not 时去掉 not；
+// 加上的 not 与比较和 if-goto 一起会被 --peephole 合并成一条条件跳转。
+// 标签的作用域是函数，只处理以 function 开头的区域；其中有重复的标签或跳到区域外的标签时整个函数保持不变。
+class ControlFlow {
+public:
+    struct Stats {
+        size_t threaded = 0;     // 改为直接跳到最终目标的跳转
+        size_t removedJumps = 0; // 删除的跳到下一块的 goto
+        size_t inverted = 0;     // 反转条件去掉的 goto
+        size_t rotated = 0;      // 旋转的循环
+        size_t removedBlocks = 0; // 删除的不可达块
+        size_t removedLabels = 0; // 删除的无用标签
+    };
+
+    // 复制到循环末尾的条件最多这么多条命令，避免代码膨胀
+    static constexpr size_t ROTATE_LIMIT = 16;
+
+    explicit ControlFlow(VMSymbols& symbols) : symbols(symbols) {}
+
+    void optimize(std::vector<VMCommand>& commands) {
+        std::vector<VMCommand> out;
+        out.reserve(commands.size());
+        size_t begin = 0;
+        while (begin < commands.size()) {
+            size_t end = begin + 1;
+            while (end < commands.size() && commands[end].opcode != Opcode::FUNCTION) end++;
+            if (commands[begin].opcode == Opcode::FUNCTION) {
+                out.push_back(commands[begin]);
+                optimizeFunction(commands, begin + 1, end, out);
+            } else {
+                out.insert(out.end(), commands.begin() + begin, commands.begin() + end);
+            }
+            begin = end;
+        }
+        commands.swap(out);
+    }
+
+    const Stats& stats() const {
+        return counts;
+    }
+
+private:
+    // 基本块：开头的标签、中间的直线代码、结尾的跳转（goto/if-goto/return，没有时顺序执行到下一块）
+    struct Block {
+        std::vector<uint32_t> labels;
+        std::vector<VMCommand> body;
+        bool hasExit = false;
+        VMCommand exit{};
+        bool removed = false;
+    };
+
+    VMSymbols& symbols;
+    Stats counts;
+    std::vector<Block> blocks;
+    std::unordered_map<uint32_t, size_t> labelBlock;
+
+    static bool isCompare(const VMCommand& command) {
+        return command.opcode == Opcode::EQ || command.opcode == Opcode::GT || command.opcode == Opcode::LT;
+    }
+
+    static bool isJump(const Block& block) {
+        return block.hasExit && (block.exit.opcode == Opcode::GOTO || block.exit.opcode == Opcode::IF_GOTO);
+    }
+
+    // 反转 body 末尾计算出的条件，使 "非零" 与 "零" 对调；不能精确反转时返回 false
+    static bool invertCondition(std::vector<VMCommand>& body) {
+        size_t n = body.size();
+        if (n >= 1 && isCompare(body[n - 1])) {
+            VMCommand negate = body[n - 1];
+            negate.opcode = Opcode::NOT;
+            body.push_back(negate);
+            return true;
+        }
+        if (n >= 2 && body[n - 1].opcode == Opcode::NOT && isCompare(body[n - 2])) {
+            body.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    // 下一个没有删除的块，没有时返回 blocks.size()
+    size_t next(size_t index) const {
+        do {
+            index++;
+        } while (index < blocks.size() && blocks[index].removed);
+        return index;
+    }
+
+    bool split(const std::vector<VMCommand>& commands, size_t begin, size_t end) {
+        blocks.clear();
+        labelBlock.clear();
+        blocks.emplace_back();
+        for (size_t i = begin; i < end; i++) {
+            const VMCommand& command = commands[i];
+            switch (command.opcode) {
+                case Opcode::LABEL:
+                    if (blocks.back().hasExit || !blocks.back().body.empty()) {
+                        blocks.emplace_back();
+                    }
+                    if (!labelBlock.emplace(command.symbol, blocks.size() - 1).second) {
+                        return false; // 重复的标签
+                    }
+                    blocks.back().labels.push_back(command.symbol);
+                    break;
+                case Opcode::GOTO:
+                case Opcode::IF_GOTO:
+                case Opcode::RETURN:
+                    if (blocks.back().hasExit) {
+                        blocks.emplace_back();
+                    }
+                    blocks.back().hasExit = true;
+                    blocks.back().exit = command;
+                    break;
+                default:
+                    if (blocks.back().hasExit) {
+                        blocks.emplace_back();
+                    }
+                    blocks.back().body.push_back(command);
+                    break;
+            }
+        }
+        for (const Block& block : blocks) {
+            if (isJump(block) && labelBlock.find(block.exit.symbol) == labelBlock.end()) {
+                return false; // 跳到函数外的标签
+            }
+        }
+        return true;
+    }
+
+    // 沿着空块和只有 goto 的块找到最终目标
+    uint32_t resolve(uint32_t label) const {
+        for (size_t steps = 0; steps < blocks.size(); steps++) {
+            size_t index = labelBlock.at(label);
+            const Block& block = blocks[index];
+            if (!block.body.empty()) break;
+            if (block.hasExit && block.exit.opcode == Opcode::GOTO) {
+                label = block.exit.symbol;
+            } else if (!block.hasExit && next(index) < blocks.size() && !blocks[next(index)].labels.empty()) {
+                label = blocks[next(index)].labels.front();
+            } else {
+                break;
+            }
+        }
+        return label;
+    }
+
+    bool threadJumps() {
+        bool changed = false;
+        for (Block& block : blocks) {
+            if (block.removed || !isJump(block)) continue;
+            uint32_t target = resolve(block.exit.symbol);
+            if (target != block.exit.symbol) {
+                block.exit.symbol = target;
+                counts.threaded++;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    bool removeJumpsToNext() {
+        bool changed = false;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            Block& block = blocks[i];
+            if (block.removed || !block.hasExit || block.exit.opcode != Opcode::GOTO) continue;
+            if (labelBlock.at(block.exit.symbol) == next(i)) {
+                block.hasExit = false;
+                counts.removedJumps++;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // B: ... if-goto L1 / C: goto L2 / D: label L1 -> B: ...（反转）if-goto L2 / D
+    bool invertJumpsOverJumps() {
+        bool changed = false;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            Block& block = blocks[i];
+            if (block.removed || !block.hasExit || block.exit.opcode != Opcode::IF_GOTO) continue;
+            size_t over = next(i);
+            if (over >= blocks.size()) continue;
+            Block& jump = blocks[over];
+            if (!jump.labels.empty() || !jump.body.empty() || !jump.hasExit || jump.exit.opcode != Opcode::GOTO ||
+                labelBlock.at(block.exit.symbol) != next(over) || !invertCondition(block.body)) {
+                continue;
+            }
+            block.exit.symbol = jump.exit.symbol;
+            jump.removed = true;
+            counts.inverted++;
+            changed = true;
+        }
+        return changed;
+    }
+
+    // X: ... goto H / ... / H: 条件 / if-goto E / N: ...，X 之后紧接着 E 时
+    // -> X: ... 条件（反转）/ if-goto N，N 没有标签时补一个
+    bool rotateLoops() {
+        bool changed = false;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (blocks[i].removed || !blocks[i].hasExit || blocks[i].exit.opcode != Opcode::GOTO) continue;
+            size_t header = labelBlock.at(blocks[i].exit.symbol);
+            const Block& head = blocks[header];
+            if (header == i || head.body.empty() || head.body.size() > ROTATE_LIMIT || !head.hasExit ||
+                head.exit.opcode != Opcode::IF_GOTO || labelBlock.at(head.exit.symbol) != next(i)) {
+                continue;
+            }
+            size_t loop = next(header);
+            if (loop >= blocks.size()) continue;
+            std::vector<VMCommand> condition = head.body;
+            if (!invertCondition(condition)) continue;
+
+            if (blocks[loop].labels.empty()) {
+                uint32_t label = symbols.intern(symbols.name(blocks[i].exit.symbol) + ".BODY");
+                if (labelBlock.count(label) != 0) continue;
+                labelBlock[label] = loop;
+                blocks[loop].labels.push_back(label);
+            }
+            Block& block = blocks[i];
+            size_t line = block.exit.line;
+            for (VMCommand command : condition) {
+                command.line = line;
+                block.body.push_back(command);
+            }
+            block.exit.opcode = Opcode::IF_GOTO;
+            block.exit.symbol = blocks[loop].labels.front();
+            counts.rotated++;
+            changed = true;
+        }
+        return changed;
+    }
+
+    bool removeUnreachable() {
+        std::vector<bool> reached(blocks.size(), false);
+        std::vector<size_t> pending = {0};
+        reached[0] = true;
+        while (!pending.empty()) {
+            size_t index = pending.back();
+            pending.pop_back();
+            const Block& block = blocks[index];
+            std::vector<size_t> successors;
+            if (isJump(block)) {
+                successors.push_back(labelBlock.at(block.exit.symbol));
+            }
+            if (!block.hasExit || block.exit.opcode == Opcode::IF_GOTO) {
+                successors.push_back(next(index));
+            }
+            for (size_t successor : successors) {
+                if (successor < blocks.size() && !reached[successor]) {
+                    reached[successor] = true;
+                    pending.push_back(successor);
+                }
+            }
+        }
+        bool changed = false;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (!blocks[i].removed && !reached[i]) {
+                blocks[i].removed = true;
+                counts.removedBlocks++;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void removeUnusedLabels() {
+        std::unordered_set<uint32_t> used;
+        for (const Block& block : blocks) {
+            if (!block.removed && isJump(block)) used.insert(block.exit.symbol);
+        }
+        for (Block& block : blocks) {
+            if (block.removed) continue;
+            std::vector<uint32_t> kept;
+            for (uint32_t label : block.labels) {
+                if (used.count(label) != 0) {
+                    kept.push_back(label);
+                } else {
+                    counts.removedLabels++;
+                }
+            }
+            block.labels.swap(kept);
+        }
+    }
+
+    void optimizeFunction(const std::vector<VMCommand>& commands, size_t begin, size_t end,
+                          std::vector<VMCommand>& out) {
+        if (begin == end || !split(commands, begin, end)) {
+            out.insert(out.end(), commands.begin() + begin, commands.begin() + end);
+            return;
+        }
+        // 每一轮都可能为下一轮创造机会（例如穿透后出现跳到下一块的 goto），次数有上限
+        for (size_t round = 0; round < 8; round++) {
+            bool changed = threadJumps();
+            changed |= invertJumpsOverJumps();
+            changed |= rotateLoops();
+            changed |= removeJumpsToNext();
+            changed |= removeUnreachable();
+            if (!changed) break;
+        }
+        removeUnusedLabels();
+
+        size_t line = commands[begin].line;
+        for (const Block& block : blocks) {
+            if (block.removed) continue;
+            for (uint32_t label : block.labels) {
+                out.push_back({Opcode::LABEL, Segment::NONE, 0, label, line});
+            }
+            out.insert(out.end(), block.body.begin(), block.body.end());
+            if (block.hasExit) {
+                out.push_back(block.exit);
+            }
+            line = out.back().line;
+        }
+    }
+};
+
+#endif
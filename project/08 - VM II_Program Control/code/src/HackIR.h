@@ -0,0 +1,287 @@
+#ifndef HACKIR_H
+#define HACKIR_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Parser.h"
+
+// Hack 指令的内存表示：CodeWriter 先生成指令列表，最后再输出为 .asm 文本（调试用），
+// 或者直接解析标签、输出 .hack 机器码，省去汇编器重新解析文本。
+// C 指令在生成时就编码成 16 位机器码；A 指令的符号、标签名和注释都驻留在符号表中，只存 id。
+struct HackInstruction {
+    enum Kind : uint8_t {
+        A_NUMBER, // @123
+        A_SYMBOL, // @LABEL / @SP / @Foo.0
+        C,        // dest=comp;jump
+        LABEL,    // (LABEL)
+        COMMENT   // 只出现在 .asm 中
+    };
+
+    Kind kind;
+    uint16_t value;  // A_NUMBER 的常量，C 的机器码
+    uint32_t symbol; // A_SYMBOL / LABEL / COMMENT 的符号 id
+};
+
+// C 指令编码：与汇编器的 Code.h 相同，把至多 3 个字符的助记符打包成整数后用 switch 分派
+namespace hack {
+
+constexpr uint32_t key(std::string_view mnemonic) {
+    if (mnemonic.size() > 3) {
+        return 0xFFFFFFFFu;
+    }
+    uint32_t k = static_cast<uint32_t>(mnemonic.size()) << 24;
+    for (size_t i = 0; i < mnemonic.size(); i++) {
+        k |= static_cast<uint32_t>(static_cast<unsigned char>(mnemonic[i])) << (8 * i);
+    }
+    return k;
+}
+
+constexpr int32_t dest(std::string_view mnemonic) {
+    switch (key(mnemonic)) {
+        case key(""):    return 0;
+        case key("M"):   return 1;
+        case key("D"):   return 2;
+        case key("MD"):  return 3;
+        case key("A"):   return 4;
+        case key("AM"):  return 5;
+        case key("AD"):  return 6;
+        case key("AMD"): return 7;
+        default:         return -1;
+    }
+}
+
+constexpr int32_t jump(std::string_view mnemonic) {
+    switch (key(mnemonic)) {
+        case key(""):    return 0;
+        case key("JGT"): return 1;
+        case key("JEQ"): return 2;
+        case key("JGE"): return 3;
+        case key("JLT"): return 4;
+        case key("JNE"): return 5;
+        case key("JLE"): return 6;
+        case key("JMP"): return 7;
+        default:         return -1;
+    }
+}
+
+// comp 的助记符，下标与 COMP_BITS 对应
+constexpr const char* COMP_NAMES[] = {
+    "0", "1", "-1", "D", "A", "!D", "!A", "-D", "-A", "D+1", "A+1", "D-1", "A-1", "D+A", "D-A",
+    "A-D", "D&A", "D|A", "M", "!M", "-M", "M+1", "M-1", "D+M", "D-M", "M-D", "D&M", "D|M",
+};
+
+// a 位和 c1..c6
+constexpr uint8_t COMP_BITS[] = {
+    0x2A, 0x3F, 0x3A, 0x0C, 0x30, 0x0D, 0x31, 0x0F, 0x33, 0x1F, 0x37, 0x0E, 0x32, 0x02, 0x13,
+    0x07, 0x00, 0x15, 0x70, 0x71, 0x73, 0x77, 0x72, 0x42, 0x53, 0x47, 0x40, 0x55,
+};
+
+constexpr int32_t comp(std::string_view mnemonic) {
+    for (size_t i = 0; i < sizeof(COMP_BITS); i++) {
+        if (mnemonic == COMP_NAMES[i]) {
+            return COMP_BITS[i];
+        }
+    }
+    return -1;
+}
+
+// dest=comp;jump -> 机器码，助记符无效时返回 0（CodeWriter 只使用固定的合法助记符）
+constexpr uint16_t encode(std::string_view text) {
+    size_t equal = text.find('=');
+    size_t semicolon = text.find(';');
+    std::string_view destText = (equal != std::string_view::npos) ? text.substr(0, equal) : std::string_view();
+    size_t start = (equal != std::string_view::npos) ? equal + 1 : 0;
+    size_t end = (semicolon != std::string_view::npos) ? semicolon : text.size();
+    std::string_view jumpText = (semicolon != std::string_view::npos) ? text.substr(semicolon + 1) : std::string_view();
+    int32_t c = comp(text.substr(start, end - start));
+    int32_t d = dest(destText);
+    int32_t j = jump(jumpText);
+    if (c < 0 || d < 0 || j < 0) {
+        return 0;
+    }
+    return static_cast<uint16_t>(0xE000 | c << 6 | d << 3 | j);
+}
+
+static_assert(encode("D=D+A") == 0xE090, "D=D+A");
+static_assert(encode("AM=M") == 0xFC28, "AM=M");
+static_assert(encode("0;JMP") == 0xEA87, "0;JMP");
+
+// 机器码 -> dest=comp;jump 文本
+inline std::string decode(uint16_t word) {
+    static const char* const DEST[] = {"", "M", "D", "MD", "A", "AM", "AD", "AMD"};
+    static const char* const JUMP[] = {"", "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP"};
+    std::string text;
+    uint8_t bits = (word >> 6) & 0x7F;
+    const char* compText = "?";
+    for (size_t i = 0; i < sizeof(COMP_BITS); i++) {
+        if (COMP_BITS[i] == bits) {
+            compText = COMP_NAMES[i];
+            break;
+        }
+    }
+    if ((word >> 3) & 7) {
+        text += DEST[(word >> 3) & 7];
+        text += '=';
+    }
+    text += compText;
+    if (word & 7) {
+        text += ';';
+        text += JUMP[word & 7];
+    }
+    return text;
+}
+
+} // namespace hack
+
+class HackProgram {
+private:
+    std::vector<HackInstruction> instructions;
+    VMSymbols symbols;
+
+public:
+    static constexpr size_t ROM_SIZE = 32768;
+
+    // 超出 0..32767 的值由 toMachineCode 报错；连 16 位也装不下的值记为 0xFFFF，同样会被拒绝
+    void number(int value) {
+        uint16_t word = (value < 0 || value > 0xFFFF) ? 0xFFFF : static_cast<uint16_t>(value);
+        instructions.push_back({HackInstruction::A_NUMBER, word, 0});
+    }
+
+    void symbol(std::string_view name) {
+        instructions.push_back({HackInstruction::A_SYMBOL, 0, symbols.intern(name)});
+    }
+
+    void c(uint16_t word) {
+        instructions.push_back({HackInstruction::C, word, 0});
+    }
+
+    void label(std::string_view name) {
+        instructions.push_back({HackInstruction::LABEL, 0, symbols.intern(name)});
+    }
+
+    void comment(std::string_view text) {
+        instructions.push_back({HackInstruction::COMMENT, 0, symbols.intern(text)});
+    }
+
+    const std::vector<HackInstruction>& code() const {
+        return instructions;
+    }
+
+    const std::string& name(uint32_t id) const {
+        return symbols.name(id);
+    }
+
+    // .asm 文本，每行以换行结束
+    std::string toAssembly() const {
+        std::string out;
+        out.reserve(instructions.size() * 8);
+        for (const HackInstruction& instruction : instructions) {
+            switch (instruction.kind) {
+                case HackInstruction::A_NUMBER:
+                    out += '@';
+                    out += std::to_string(instruction.value);
+                    break;
+                case HackInstruction::A_SYMBOL:
+                    out += '@';
+                    out += symbols.name(instruction.symbol);
+                    break;
+                case HackInstruction::C:
+                    out += hack::decode(instruction.value);
+                    break;
+                case HackInstruction::LABEL:
+                    out += '(';
+                    out += symbols.name(instruction.symbol);
+                    out += ')';
+                    break;
+                case HackInstruction::COMMENT:
+                    out += "// ";
+                    out += symbols.name(instruction.symbol);
+                    break;
+            }
+            out += '\n';
+        }
+        return out;
+    }
+
+    // 解析标签和变量得到机器码，规则与汇编器相同：标签以最后一次定义为准，
+    // 其余符号按首次出现的顺序从 RAM[16] 分配。超出 32K ROM 或常量超出 15 位时返回 false，
+    // 与汇编器拒绝同一份 .asm 一致
+    bool toMachineCode(std::vector<uint16_t>& words, std::string& error) const {
+        const int UNRESOLVED = -1;
+        std::vector<int> address(symbols.size(), UNRESOLVED);
+        size_t romAddress = 0;
+        for (const HackInstruction& instruction : instructions) {
+            if (instruction.kind == HackInstruction::LABEL) {
+                address[instruction.symbol] = static_cast<int>(romAddress);
+            } else if (instruction.kind != HackInstruction::COMMENT) {
+                romAddress++;
+            }
+        }
+        if (romAddress > ROM_SIZE) {
+            error = "程序长度 " + std::to_string(romAddress) + " 超出 32K ROM";
+            return false;
+        }
+
+        words.clear();
+        words.reserve(romAddress);
+        int nextVariable = 16;
+        for (const HackInstruction& instruction : instructions) {
+            switch (instruction.kind) {
+                case HackInstruction::A_NUMBER:
+                    if (instruction.value > 0x7FFF) {
+                        error = "ROM[" + std::to_string(words.size()) + "] 的常量超出 A 指令的 15 位范围";
+                        return false;
+                    }
+                    words.push_back(instruction.value);
+                    break;
+                case HackInstruction::C:
+                    words.push_back(instruction.value);
+                    break;
+                case HackInstruction::A_SYMBOL: {
+                    int& resolved = address[instruction.symbol];
+                    if (resolved == UNRESOLVED) {
+                        resolved = predefinedAddress(symbols.name(instruction.symbol));
+                        if (resolved == UNRESOLVED) {
+                            resolved = nextVariable++;
+                        }
+                    }
+                    words.push_back(static_cast<uint16_t>(resolved));
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    // 预定义符号的地址，不是预定义符号时返回 -1
+    static int predefinedAddress(const std::string& name) {
+        static const std::unordered_map<std::string, int> PREDEFINED = {
+            {"SP", 0}, {"LCL", 1}, {"ARG", 2}, {"THIS", 3}, {"THAT", 4},
+            {"R0", 0}, {"R1", 1}, {"R2", 2}, {"R3", 3}, {"R4", 4}, {"R5", 5}, {"R6", 6}, {"R7", 7},
+            {"R8", 8}, {"R9", 9}, {"R10", 10}, {"R11", 11}, {"R12", 12}, {"R13", 13}, {"R14", 14}, {"R15", 15},
+            {"SCREEN", 16384}, {"KBD", 24576},
+        };
+        auto found = PREDEFINED.find(name);
+        return (found != PREDEFINED.end()) ? found->second : -1;
+    }
+
+    // .hack 文本：每行 16 个 '0'/'1'，行间用换行分隔，末尾不换行（与汇编器的输出相同）
+    static std::string formatHack(const std::vector<uint16_t>& words) {
+        std::string out(words.empty() ? 0 : words.size() * 17 - 1, '\n');
+        char* cursor = &out[0];
+        for (size_t i = 0; i < words.size(); i++) {
+            for (int bit = 15; bit >= 0; bit--) {
+                *cursor++ = ((words[i] >> bit) & 1) ? '1' : '0';
+            }
+            cursor++;
+        }
+        return out;
+    }
+};
+
+#endif
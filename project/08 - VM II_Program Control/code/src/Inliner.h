@@ -0,0 +1,259 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Parser.h"
+
+// 小型叶子函数的内联：Memory.peek、Math.abs、String.charAt 这类函数只有几条命令，
+// 却要付出完整的 call/return 帧开销。在 VM 层把 call 替换成函数体：
+//   - 参数从栈上弹出到保留的槽位，局部变量的槽位清零；argument / local 改为访问槽位
+//   - 槽位是伪文件 "$inline" 的 static 变量（"$" 不会出现在 Jack 类名中），汇编器从 RAM[16] 起分配。
+//     叶子函数的函数体内没有调用，内联后的代码不会嵌套，所有调用处可以共用同一组槽位
+//   - 函数体中的 static 命令本来就带着被调用者的文件（见 VMCommand::symbol），仍访问原来的变量
+//   - 函数体改写了 pointer 0/1 时，先保存 THIS/THAT，在每个 return 处恢复，与 return 恢复调用者的帧一致
+//   - 标签加上调用处编号作为前缀，return 改为跳到内联代码末尾
+// 只内联满足以下条件的函数：整个程序中只有一份定义；函数体不超过 limit 条命令且没有 call；
+// 栈深度可以静态确定——不会弹出进入函数时栈上已有的内容，每个 return 处恰好剩下返回值，
+// 所有跳转都落在函数体内，而且不会执行到函数体末尾之后。
+class Inliner {
+public:
+    struct Callee {
+        uint32_t name;
+        size_t file;
+        size_t begin; // function 命令之后的函数体 [begin, end)
+        size_t end;
+        int locals;
+        int arguments;     // 函数体访问的 argument 最大下标 + 1
+        bool writesThis;
+        bool writesThat;
+        size_t inlined = 0; // 被内联的调用处个数
+    };
+
+    // --inline 不带参数时的函数体长度上限，覆盖 OS 中的 Memory.peek/poke、Math.abs 等
+    static constexpr size_t DEFAULT_LIMIT = 12;
+
+    explicit Inliner(size_t limit) : limit(limit) {}
+
+    // 在所有文件中内联符合条件的调用，返回内联的调用处个数
+    size_t run(std::vector<std::vector<VMCommand>>& files, VMSymbols& symbols) {
+        findCallees(files);
+        slotFile = symbols.intern("$inline");
+        size_t sites = 0;
+        // 函数体从原始命令中复制，先保留一份，避免改写调用者所在文件时影响被调用者
+        std::vector<std::vector<VMCommand>> original = files;
+        for (std::vector<VMCommand>& commands : files) {
+            std::vector<VMCommand> out;
+            out.reserve(commands.size());
+            for (const VMCommand& command : commands) {
+                auto found = (command.opcode == Opcode::CALL) ? calleeIndex.find(command.symbol) : calleeIndex.end();
+                if (found == calleeIndex.end() || command.index < callees[found->second].arguments) {
+                    out.push_back(command);
+                    continue;
+                }
+                Callee& callee = callees[found->second];
+                expand(callee, original[callee.file], command, sites++, symbols, out);
+                callee.inlined++;
+            }
+            commands.swap(out);
+        }
+        return sites;
+    }
+
+    const std::vector<Callee>& candidates() const {
+        return callees;
+    }
+
+private:
+    size_t limit;
+    uint32_t slotFile = 0;
+    std::vector<Callee> callees;
+    std::unordered_map<uint32_t, size_t> calleeIndex;
+
+    void findCallees(const std::vector<std::vector<VMCommand>>& files) {
+        std::unordered_map<uint32_t, size_t> definitions;
+        std::vector<Callee> functions;
+        for (size_t file = 0; file < files.size(); file++) {
+            const std::vector<VMCommand>& commands = files[file];
+            for (size_t i = 0; i < commands.size(); i++) {
+                if (commands[i].opcode != Opcode::FUNCTION) continue;
+                size_t end = i + 1;
+                while (end < commands.size() && commands[end].opcode != Opcode::FUNCTION) end++;
+                definitions[commands[i].symbol]++;
+                functions.push_back({commands[i].symbol, file, i + 1, end, commands[i].index, 0, false, false});
+            }
+        }
+        for (Callee& function : functions) {
+            if (definitions[function.name] == 1 && eligible(files[function.file], function)) {
+                calleeIndex[function.name] = callees.size();
+                callees.push_back(function);
+            }
+        }
+    }
+
+    bool eligible(const std::vector<VMCommand>& commands, Callee& callee) const {
+        if (callee.end - callee.begin > limit || callee.end == callee.begin) {
+            return false;
+        }
+        std::unordered_map<uint32_t, int> labelDepth;
+        std::vector<uint32_t> targets;
+        // 记录跳转目标处的栈深度，同一标签的深度必须一致
+        auto reach = [&labelDepth](uint32_t label, int depth) {
+            auto found = labelDepth.find(label);
+            if (found == labelDepth.end()) {
+                labelDepth[label] = depth;
+                return true;
+            }
+            return found->second == depth;
+        };
+
+        int depth = 0;
+        bool reachable = true;
+        for (size_t i = callee.begin; i < callee.end; i++) {
+            const VMCommand& command = commands[i];
+            if (command.opcode == Opcode::LABEL) {
+                auto found = labelDepth.find(command.symbol);
+                if (!reachable) {
+                    if (found == labelDepth.end()) return false; // 只能从后面跳回来的死代码，不做判断
+                    depth = found->second;
+                    reachable = true;
+                } else if (!reach(command.symbol, depth)) {
+                    return false;
+                }
+                continue;
+            }
+            if (!reachable) {
+                return false;
+            }
+            switch (command.opcode) {
+                case Opcode::PUSH:
+                    if (command.segment == Segment::ARGUMENT) {
+                        callee.arguments = std::max(callee.arguments, command.index + 1);
+                    }
+                    depth++;
+                    break;
+                case Opcode::POP:
+                    if (command.segment == Segment::ARGUMENT) {
+                        callee.arguments = std::max(callee.arguments, command.index + 1);
+                    }
+                    if (command.segment == Segment::POINTER) {
+                        (command.index == 0 ? callee.writesThis : callee.writesThat) = true;
+                    }
+                    if (--depth < 0) return false;
+                    break;
+                case Opcode::NEG:
+                case Opcode::NOT:
+                    if (depth < 1) return false;
+                    break;
+                case Opcode::IF_GOTO:
+                    if (--depth < 0) return false;
+                    if (!reach(command.symbol, depth)) return false;
+                    targets.push_back(command.symbol);
+                    break;
+                case Opcode::GOTO:
+                    if (!reach(command.symbol, depth)) return false;
+                    targets.push_back(command.symbol);
+                    reachable = false;
+                    break;
+                case Opcode::RETURN:
+                    if (depth != 1) return false;
+                    reachable = false;
+                    break;
+                case Opcode::CALL:
+                case Opcode::FUNCTION:
+                    return false;
+                default: // 二元运算
+                    if (commandType(command.opcode) != C_ARITHMETIC) return false;
+                    if (--depth < 1) return false;
+                    break;
+            }
+        }
+        if (reachable) {
+            return false;
+        }
+        // 跳转目标必须是函数体内定义的标签
+        for (uint32_t target : targets) {
+            bool defined = false;
+            for (size_t i = callee.begin; i < callee.end && !defined; i++) {
+                defined = commands[i].opcode == Opcode::LABEL && commands[i].symbol == target;
+            }
+            if (!defined) return false;
+        }
+        return true;
+    }
+
+    VMCommand slot(Opcode opcode, int index, size_t line) const {
+        return {opcode, Segment::STATIC, index, slotFile, line};
+    }
+
+    void expand(const Callee& callee, const std::vector<VMCommand>& commands, const VMCommand& call, size_t site,
+                VMSymbols& symbols, std::vector<VMCommand>& out) const {
+        int nArgs = call.index;
+        int saveThis = nArgs + callee.locals;
+        int saveThat = saveThis + 1;
+        size_t line = call.line;
+        std::string prefix = "$" + std::to_string(site);
+        uint32_t endLabel = symbols.intern(prefix);
+
+        for (int i = nArgs - 1; i >= 0; i--) {
+            out.push_back(slot(Opcode::POP, i, line));
+        }
+        for (int i = 0; i < callee.locals; i++) {
+            out.push_back({Opcode::PUSH, Segment::CONSTANT, 0, 0, line});
+            out.push_back(slot(Opcode::POP, nArgs + i, line));
+        }
+        if (callee.writesThis) {
+            out.push_back({Opcode::PUSH, Segment::POINTER, 0, 0, line});
+            out.push_back(slot(Opcode::POP, saveThis, line));
+        }
+        if (callee.writesThat) {
+            out.push_back({Opcode::PUSH, Segment::POINTER, 1, 0, line});
+            out.push_back(slot(Opcode::POP, saveThat, line));
+        }
+
+        for (size_t i = callee.begin; i < callee.end; i++) {
+            VMCommand command = commands[i];
+            command.line = line;
+            switch (command.opcode) {
+                case Opcode::PUSH:
+                case Opcode::POP:
+                    if (command.segment == Segment::ARGUMENT) {
+                        command = slot(command.opcode, command.index, line);
+                    } else if (command.segment == Segment::LOCAL) {
+                        command = slot(command.opcode, nArgs + command.index, line);
+                    }
+                    out.push_back(command);
+                    break;
+                case Opcode::LABEL:
+                case Opcode::GOTO:
+                case Opcode::IF_GOTO:
+                    command.symbol = symbols.intern(prefix + "." + symbols.name(command.symbol));
+                    out.push_back(command);
+                    break;
+                case Opcode::RETURN:
+                    if (callee.writesThis) {
+                        out.push_back(slot(Opcode::PUSH, saveThis, line));
+                        out.push_back({Opcode::POP, Segment::POINTER, 0, 0, line});
+                    }
+                    if (callee.writesThat) {
+                        out.push_back(slot(Opcode::PUSH, saveThat, line));
+                        out.push_back({Opcode::POP, Segment::POINTER, 1, 0, line});
+                    }
+                    if (i + 1 < callee.end) {
+                        out.push_back({Opcode::GOTO, Segment::NONE, 0, endLabel, line});
+                    }
+                    break;
+                default:
+                    out.push_back(command);
+                    break;
+            }
+        }
+        out.push_back({Opcode::LABEL, Segment::NONE, 0, endLabel, line});
+    }
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Parser.h"
+
+// VM 级 peephole 优化：在代码生成之前扫描解码后的命令流，用规则表把常见的相邻命令合并。
+// 每输出一条命令就按表中顺序尝试所有规则，匹配的是输出末尾的 length 条命令，
+// 替换后继续在新的末尾上匹配，因此折叠出的常量可以继续参与后面的规则（例如 push/pop 合并）。
+// 标签、函数、调用本身也是命令，规则不会跨过它们。
+class Peephole {
+public:
+    // 一条规则：匹配成功时把替换结果写入 replacement 并返回 true
+    struct Rule {
+        const char* name;
+        size_t length;
+        bool (*apply)(const VMCommand* window, std::vector<VMCommand>& replacement);
+    };
+
+    // 把 value 截断成 16 位有符号数，与 Hack 的算术一致
+    static int wrap(int value) {
+        return static_cast<int16_t>(static_cast<uint16_t>(value));
+    }
+
+    static bool isPushConstant(const VMCommand& command) {
+        return command.opcode == Opcode::PUSH && command.segment == Segment::CONSTANT;
+    }
+
+    static VMCommand pushConstant(int value, size_t line) {
+        return {Opcode::PUSH, Segment::CONSTANT, wrap(value), 0, line};
+    }
+
+    // push constant c / neg|not -> push constant (-c | !c)
+    static bool foldUnary(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isPushConstant(w[0])) return false;
+        if (w[1].opcode == Opcode::NEG) {
+            replacement.push_back(pushConstant(-w[0].index, w[0].line));
+        } else if (w[1].opcode == Opcode::NOT) {
+            replacement.push_back(pushConstant(~w[0].index, w[0].line));
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // push constant a / push constant b / 二元运算 -> push constant 结果。
+    // 比较按 CodeWriter 的做法计算 16 位的 a-b 再看符号，溢出时的结果也与运行时相同
+    static bool foldBinary(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isPushConstant(w[0]) || !isPushConstant(w[1])) return false;
+        int x = w[0].index;
+        int y = w[1].index;
+        int difference = wrap(x - y);
+        int result;
+        switch (w[2].opcode) {
+            case Opcode::ADD: result = x + y; break;
+            case Opcode::SUB: result = x - y; break;
+            case Opcode::AND: result = x & y; break;
+            case Opcode::OR:  result = x | y; break;
+            case Opcode::EQ:  result = (difference == 0) ? -1 : 0; break;
+            case Opcode::GT:  result = (difference > 0) ? -1 : 0; break;
+            case Opcode::LT:  result = (difference < 0) ? -1 : 0; break;
+            default: return false;
+        }
+        replacement.push_back(pushConstant(result, w[0].line));
+        return true;
+    }
+
+    // push constant c / if-goto L -> goto L（c != 0）或者什么都不做（c == 0）
+    static bool foldBranch(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isPushConstant(w[0]) || w[1].opcode != Opcode::IF_GOTO) return false;
+        if (w[0].index != 0) {
+            VMCommand jump = w[1];
+            jump.opcode = Opcode::GOTO;
+            replacement.push_back(jump);
+        }
+        return true;
+    }
+
+    // push constant k / add|sub -> 栈顶直接加减常量，k == 0 时整对删除
+    static bool addConstant(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isPushConstant(w[0])) return false;
+        int value;
+        if (w[1].opcode == Opcode::ADD) {
+            value = w[0].index;
+        } else if (w[1].opcode == Opcode::SUB) {
+            value = wrap(-w[0].index);
+        } else {
+            return false;
+        }
+        if (value != 0) {
+            replacement.push_back({Opcode::ADD_CONSTANT, Segment::NONE, value, 0, w[0].line});
+        }
+        return true;
+    }
+
+    // push S i / pop S i -> 删除
+    static bool selfMove(const VMCommand* w, std::vector<VMCommand>&) {
+        return w[0].opcode == Opcode::PUSH && w[1].opcode == Opcode::POP &&
+               w[0].segment == w[1].segment && w[0].index == w[1].index && w[0].symbol == w[1].symbol;
+    }
+
+    // push S i / pop T j -> 内存到内存直接复制，不经过栈。
+    // 合并后的命令只能带一个文件，两端是不同文件的 static 变量时（内联后可能出现）不合并
+    static bool move(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (w[0].opcode != Opcode::PUSH || w[1].opcode != Opcode::POP) return false;
+        if (w[0].segment == Segment::STATIC && w[1].segment == Segment::STATIC && w[0].symbol != w[1].symbol) {
+            return false;
+        }
+        VMCommand command = w[0];
+        if (w[1].segment == Segment::STATIC) {
+            command.symbol = w[1].symbol;
+        }
+        command.opcode = Opcode::MOVE;
+        command.targetSegment = w[1].segment;
+        command.targetIndex = w[1].index;
+        replacement.push_back(command);
+        return true;
+    }
+
+    // pop S i / push S i -> 把栈顶写入 S i，但不弹出
+    static bool store(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (w[0].opcode != Opcode::POP || w[1].opcode != Opcode::PUSH ||
+            w[0].segment != w[1].segment || w[0].index != w[1].index || w[0].symbol != w[1].symbol) {
+            return false;
+        }
+        VMCommand command = w[0];
+        command.opcode = Opcode::STORE;
+        replacement.push_back(command);
+        return true;
+    }
+
+    // eq|gt|lt 对应的条件跳转操作码，negate 时取相反的条件（IF_EQ/IF_NE 等相邻排列）
+    static Opcode branchOpcode(Opcode compare, bool negate) {
+        int base = compare == Opcode::EQ ? 0 : compare == Opcode::GT ? 2 : 4;
+        return static_cast<Opcode>(static_cast<int>(Opcode::IF_EQ) + base + (negate ? 1 : 0));
+    }
+
+    static bool isCompare(const VMCommand& command) {
+        return command.opcode == Opcode::EQ || command.opcode == Opcode::GT || command.opcode == Opcode::LT;
+    }
+
+    // eq|gt|lt / if-goto L -> 直接比较 x-y 并条件跳转，不在栈上生成布尔值（if 语句）
+    static bool compareBranch(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isCompare(w[0]) || w[1].opcode != Opcode::IF_GOTO) return false;
+        VMCommand jump = w[1];
+        jump.opcode = branchOpcode(w[0].opcode, false);
+        replacement.push_back(jump);
+        return true;
+    }
+
+    // eq|gt|lt / not / if-goto L -> 按相反的条件跳转（while 语句的循环条件）。
+    // 比较的结果只有 -1 和 0，取反后恰好对应相反的条件
+    static bool compareNotBranch(const VMCommand* w, std::vector<VMCommand>& replacement) {
+        if (!isCompare(w[0]) || w[1].opcode != Opcode::NOT || w[2].opcode != Opcode::IF_GOTO) return false;
+        VMCommand jump = w[2];
+        jump.opcode = branchOpcode(w[0].opcode, true);
+        replacement.push_back(jump);
+        return true;
+    }
+
+    // not / not、neg / neg -> 删除
+    static bool involution(const VMCommand* w, std::vector<VMCommand>&) {
+        return w[0].opcode == w[1].opcode && (w[0].opcode == Opcode::NOT || w[0].opcode == Opcode::NEG);
+    }
+
+    // 规则表，按优先级排列：较长的常量折叠在前，避免被 add-constant 抢先匹配
+    static const std::vector<Rule>& rules() {
+        static const std::vector<Rule> RULES = {
+            {"fold-binary", 3, foldBinary},
+            {"fold-unary",  2, foldUnary},
+            {"fold-branch", 2, foldBranch},
+            {"compare-not-branch", 3, compareNotBranch},
+            {"compare-branch", 2, compareBranch},
+            {"add-constant", 2, addConstant},
+            {"self-move",   2, selfMove},
+            {"move",        2, move},
+            {"store",       2, store},
+            {"involution",  2, involution},
+        };
+        return RULES;
+    }
+
+    Peephole() : counts(rules().size(), 0) {}
+
+    std::vector<VMCommand> optimize(const std::vector<VMCommand>& commands) {
+        std::vector<VMCommand> out;
+        out.reserve(commands.size());
+        std::vector<VMCommand> replacement;
+        for (const VMCommand& command : commands) {
+            out.push_back(command);
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                const std::vector<Rule>& table = rules();
+                for (size_t i = 0; i < table.size(); i++) {
+                    if (out.size() < table[i].length) continue;
+                    replacement.clear();
+                    if (table[i].apply(&out[out.size() - table[i].length], replacement)) {
+                        out.resize(out.size() - table[i].length);
+                        out.insert(out.end(), replacement.begin(), replacement.end());
+                        counts[i]++;
+                        changed = !out.empty();
+                        break;
+                    }
+                }
+            }
+        }
+        return out;
+    }
+
+    // 每条规则的命中次数，下标与 rules() 对应
+    const std::vector<size_t>& hits() const {
+        return counts;
+    }
+
+private:
+    std::vector<size_t> counts;
+};
+
+#endif
@@ -4,7 +4,36 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include "Parser.h"
+#include "CallGraph.h"
 #include "CodeWriter.h"
+#include "ControlFlow.h"
+#include "Inliner.h"
+#include "Peephole.h"
+
+// 代码生成之前的 VM 级优化，统计在所有文件上累计
+struct VMPasses {
+    ControlFlow flow;
+    Peephole peephole;
+
+    explicit VMPasses(VMSymbols& symbols) : flow(symbols) {}
+};
+
+// 输出控制流优化的统计
+void printFlowStats(const ControlFlow& flow) {
+    const ControlFlow::Stats& stats = flow.stats();
+    std::cout << "flow: threaded " << stats.threaded << " removed-jumps " << stats.removedJumps
+              << " inverted " << stats.inverted << " rotated " << stats.rotated
+              << " removed-blocks " << stats.removedBlocks << " removed-labels " << stats.removedLabels << std::endl;
+}
+
+// 输出每条 peephole 规则的命中次数
+void printPeepholeHits(const Peephole& peephole) {
+    std::cout << "peephole:";
+    for (size_t i = 0; i < Peephole::rules().size(); i++) {
+        std::cout << " " << Peephole::rules()[i].name << " " << peephole.hits()[i];
+    }
+    std::cout << std::endl;
+}
 
 // 检查路径是否是目录
 bool isDirectory(const std::string& path) {
@@ -34,57 +63,170 @@ std::vector<std::string> getVMFiles(const std::string& dirPath) {
     return vmFiles;
 }
 
-// 翻译单个 VM 文件
-void translateFile(const std::string& vmFile, CodeWriter& writer) {
-    Parser parser(vmFile);
+// 解析整个 VM 文件，出错时报告并返回 false
+bool parseFile(const std::string& vmFile, VMSymbols& symbols, std::vector<VMCommand>& commands) {
+    Parser parser(vmFile, symbols);
+    if (!parser.isOpen()) {
+        std::cerr << "无法打开输入文件: " << vmFile << std::endl;
+        return false;
+    }
+    if (!parser.errors().empty()) {
+        for (const std::string& error : parser.errors()) {
+            std::cerr << vmFile << ": " << error << std::endl;
+        }
+        return false;
+    }
+    commands = parser.commands();
+    return true;
+}
+
+// 生成一个文件的代码：（可选）经过控制流优化和 peephole 优化，再按操作码分派给 CodeWriter
+void writeFile(const std::string& vmFile, const std::vector<VMCommand>& commands, CodeWriter& writer,
+               const VMSymbols& symbols, const CodeGenOptions& options, VMPasses& passes) {
     writer.setFileName(vmFile);
+    const std::vector<VMCommand>* source = &commands;
+    std::vector<VMCommand> optimized;
+    if (options.controlFlow) {
+        optimized = commands;
+        passes.flow.optimize(optimized);
+        source = &optimized;
+    }
+    if (options.peephole) {
+        optimized = passes.peephole.optimize(*source);
+        source = &optimized;
+    }
+    for (const VMCommand& command : *source) {
+        writer.writeCommand(command, symbols);
+    }
+}
 
-    while (parser.hasMoreCommands()) {
-        parser.advance();
+// 翻译单个 VM 文件：解析器先把整个文件解码成 VMCommand，再生成代码
+bool translateFile(const std::string& vmFile, CodeWriter& writer, VMSymbols& symbols,
+                   const CodeGenOptions& options, VMPasses& passes) {
+    std::vector<VMCommand> commands;
+    if (!parseFile(vmFile, symbols, commands)) {
+        return false;
+    }
+    writeFile(vmFile, commands, writer, symbols, options, passes);
+    return true;
+}
 
-        // 跳过空命令
-        if (parser.getCurrentCommand().empty()) {
-            break;
-        }
+// 内联小型叶子函数，报告每个被内联的函数及调用处个数
+void inlineCalls(std::vector<std::vector<VMCommand>>& files, VMSymbols& symbols, size_t limit) {
+    Inliner inliner(limit);
+    size_t sites = inliner.run(files, symbols);
+    std::cout << "内联了 " << sites << " 处调用" << std::endl;
+    for (const Inliner::Callee& callee : inliner.candidates()) {
+        if (callee.inlined == 0) continue;
+        std::cout << "  " << symbols.name(callee.name) << " (" << callee.end - callee.begin << " 条命令) x "
+                  << callee.inlined << std::endl;
+    }
+}
 
-        CommandType cmdType = parser.commandType();
+// 从 Sys.init 出发删除不可达的函数
+void removeDeadFunctions(std::vector<std::vector<VMCommand>>& files, VMSymbols& symbols) {
+    CallGraph graph(files);
+    std::vector<uint32_t> unresolved;
+    if (!graph.markReachable(symbols.intern("Sys.init"), unresolved)) {
+        std::cerr << "警告: 没有找到 Sys.init，保留所有函数" << std::endl;
+    }
+    for (uint32_t name : unresolved) {
+        std::cerr << "警告: 调用了未定义的函数 " << symbols.name(name) << std::endl;
+    }
+    size_t before = 0;
+    for (const std::vector<VMCommand>& commands : files) before += commands.size();
+    std::vector<CallGraph::Function> removed = graph.removeDead(files);
+    size_t after = 0;
+    for (const std::vector<VMCommand>& commands : files) after += commands.size();
 
-        if (cmdType == C_ARITHMETIC) {
-            writer.writeArithmetic(parser.arg1());
-        }
-        else if (cmdType == C_PUSH || cmdType == C_POP) {
-            std::string command = (cmdType == C_PUSH) ? "push" : "pop";
-            writer.writePushPop(command, parser.arg1(), parser.arg2());
-        }
-        else if (cmdType == C_LABEL) {
-            writer.writeLabel(parser.arg1());
-        }
-        else if (cmdType == C_GOTO) {
-            writer.writeGoto(parser.arg1());
-        }
-        else if (cmdType == C_IF) {
-            writer.writeIf(parser.arg1());
-        }
-        else if (cmdType == C_FUNCTION) {
-            writer.writeFunction(parser.arg1(), parser.arg2());
-        }
-        else if (cmdType == C_CALL) {
-            writer.writeCall(parser.arg1(), parser.arg2());
-        }
-        else if (cmdType == C_RETURN) {
-            writer.writeReturn();
+    std::cout << "删除了 " << removed.size() << " / " << graph.all().size() << " 个不可达的函数，共 "
+              << before - after << " / " << before << " 条 VM 命令" << std::endl;
+    for (const CallGraph::Function& function : removed) {
+        std::cout << "  " << symbols.name(function.name) << " (" << function.end - function.begin << " 条命令)"
+                  << std::endl;
+    }
+}
+
+// 选项 arg 在前缀 prefix 个字符之后是否为 1-9 位十进制数（更长的数 stoul 会溢出，也没有意义）
+bool isCount(const std::string& arg, size_t prefix) {
+    return arg.size() > prefix && arg.size() - prefix <= 9 &&
+           arg.find_first_not_of("0123456789", prefix) == std::string::npos;
+}
+
+// 整个程序的翻译：先解码所有文件，（可选）内联小型叶子函数、删除不可达的函数，再生成代码。
+// 内联放在删除之前，所有调用处都被内联的函数随后会被当作不可达删除
+bool translateProgram(const std::vector<std::string>& vmFiles, CodeWriter& writer, VMSymbols& symbols,
+                      const CodeGenOptions& options, VMPasses& passes, size_t inlineLimit, bool removeDead) {
+    std::vector<std::vector<VMCommand>> files(vmFiles.size());
+    for (size_t i = 0; i < vmFiles.size(); i++) {
+        std::cout << "解析文件: " << vmFiles[i] << std::endl;
+        if (!parseFile(vmFiles[i], symbols, files[i])) {
+            return false;
         }
     }
+
+    if (inlineLimit > 0) {
+        inlineCalls(files, symbols, inlineLimit);
+    }
+    if (removeDead) {
+        removeDeadFunctions(files, symbols);
+    }
+
+    for (size_t i = 0; i < vmFiles.size(); i++) {
+        writeFile(vmFiles[i], files[i], writer, symbols, options, passes);
+    }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "用法: " << argv[0] << " <input.vm 或 directory>" << std::endl;
+    std::string input;
+    EmitFormat format = EmitFormat::ASM;
+    CodeGenOptions options;
+    bool wholeProgram = false;
+    size_t inlineLimit = 0;
+    bool usageError = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--emit=asm") {
+            format = EmitFormat::ASM;
+        } else if (arg == "--emit=hack") {
+            format = EmitFormat::HACK;
+        } else if (arg == "--compare=inline") {
+            options.compare = CompareMode::INLINE;
+        } else if (arg == "--compare=shared") {
+            options.compare = CompareMode::SHARED;
+        } else if (arg == "--call=inline") {
+            options.call = CallMode::INLINE;
+        } else if (arg == "--call=shared") {
+            options.call = CallMode::SHARED;
+        } else if (arg == "--peephole") {
+            options.peephole = true;
+        } else if (arg == "--flow") {
+            options.controlFlow = true;
+        } else if (arg == "--tos-cache") {
+            options.tosCache = true;
+        } else if (arg == "--whole-program") {
+            wholeProgram = true;
+        } else if (arg == "--inline") {
+            inlineLimit = Inliner::DEFAULT_LIMIT;
+        } else if (arg.rfind("--inline=", 0) == 0 && isCount(arg, 9)) {
+            inlineLimit = std::stoul(arg.substr(9));
+        } else if (arg.rfind("--", 0) == 0 || !input.empty()) {
+            usageError = true;
+        } else {
+            input = arg;
+        }
+    }
+    if (usageError || input.empty()) {
+        std::cerr << "用法: " << argv[0] << " [--emit=asm|hack] [--compare=inline|shared] [--call=inline|shared] [--flow] [--peephole] [--tos-cache] [--whole-program] [--inline[=N]] <input.vm 或 directory>" << std::endl;
         return 1;
     }
 
-    std::string input = argv[1];
-    
+    // --emit=hack 时跳过汇编文本，直接输出机器码
+    std::string extension = (format == EmitFormat::HACK) ? ".hack" : ".asm";
+    VMSymbols symbols;
+    VMPasses passes(symbols);
+
     if (isDirectory(input)) {
         // 处理目录
         std::vector<std::string> vmFiles = getVMFiles(input);
@@ -105,30 +247,63 @@ int main(int argc, char* argv[]) {
                              ? dirPath 
                              : dirPath.substr(lastSlash + 1);
         
-        std::string outputFile = dirPath + "/" + dirName + ".asm";
-        CodeWriter writer(outputFile);
+        std::string outputFile = dirPath + "/" + dirName + extension;
+        CodeWriter writer(outputFile, format, options);
 
         // 写入启动代码（当翻译目录时）
         writer.writeInit();
 
         // 翻译所有 VM 文件
-        for (const auto& vmFile : vmFiles) {
-            std::cout << "翻译文件: " << vmFile << std::endl;
-            translateFile(vmFile, writer);
+        if (wholeProgram || inlineLimit > 0) {
+            if (!translateProgram(vmFiles, writer, symbols, options, passes, inlineLimit, wholeProgram)) {
+                return 1;
+            }
+        } else {
+            for (const auto& vmFile : vmFiles) {
+                std::cout << "翻译文件: " << vmFile << std::endl;
+                if (!translateFile(vmFile, writer, symbols, options, passes)) {
+                    return 1;
+                }
+            }
         }
 
-        writer.close();
+        if (!writer.close()) {
+            return 1;
+        }
+        if (options.controlFlow) {
+            printFlowStats(passes.flow);
+        }
+        if (options.peephole) {
+            printPeepholeHits(passes.peephole);
+        }
         std::cout << "目录翻译成功！输出文件: " << outputFile << std::endl;
     }
     else {
         // 处理单个文件
-        std::string outputFile = input.substr(0, input.find_last_of('.')) + ".asm";
-        CodeWriter writer(outputFile);
+        std::string outputFile = input.substr(0, input.find_last_of('.')) + extension;
+        CodeWriter writer(outputFile, format, options);
 
         // 翻译单个文件（不生成启动代码）
-        translateFile(input, writer);
+        if (wholeProgram) {
+            std::cerr << "警告: --whole-program 只在翻译目录时有效，已忽略" << std::endl;
+        }
+        if (inlineLimit > 0) {
+            if (!translateProgram({input}, writer, symbols, options, passes, inlineLimit, false)) {
+                return 1;
+            }
+        } else if (!translateFile(input, writer, symbols, options, passes)) {
+            return 1;
+        }
 
-        writer.close();
+        if (!writer.close()) {
+            return 1;
+        }
+        if (options.controlFlow) {
+            printFlowStats(passes.flow);
+        }
+        if (options.peephole) {
+            printPeepholeHits(passes.peephole);
+        }
         std::cout << "翻译成功！输出文件: " << outputFile << std::endl;
     }
 